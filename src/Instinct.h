@@ -664,12 +664,9 @@ const char restlaidout[] PROGMEM = {
 		//if it's not the main sketch to save data or there's no external EEPROM, 
 		//the list should always contain all information.
   const char* skillNameWithType[]={"bdI","bkI","bkLI","bkRI","crI","crLI","crRI","lyI","stairN","trI","trLI","trRI","vtI","wkFI","wkLI","wkRI","balanceI","buttUpI","calibI","cd1I","cd2I","droppedI","liftedI","peeI","pee1I","pu1I","pu2I","rc1I","rc10I","rc2I","rc3I","rc4I","rc5I","rc6I","rc7I","rc8I","rc9I","restI","sitI","sleepI","strI","zeroI",};
-#if 0
-  const char* progmemPointer[] = {bd, bk, bkL, bkR, cr, crL, crR, ly, stair, tr, trL, trR, vt, wkF, wkL, wkR, balance, buttUp, calib, cd1, cd2, dropped, lifted, pee, pee1, pu1, pu2, rc1, rc10, rc2, rc3, rc4, rc5, rc6, rc7, rc8, rc9, rest, sit, sleep, str, zero, };
-#else
-  const char* progmemPointer[] = {00, bk, bkL, bkR, cr, 000, 000, 00, 00000, tr, trL, trR, vt, wkF, wkL, wkR, balance, 000000, calib, 000, 000, 0000000, 000000, 000, 0000, 000, 000, 000, 0000, 000, 000, 000, 000, 000, 000, 000, 000, rest, sit, sleep, str, 0000, fistbump, restlaidout};
-#endif
-
+  // skill_frames_gen delta encodes the frames, which leaves room in flash
+  // for every skill.
+  const char* progmemPointer[] = {bd, bk, bkL, bkR, cr, crL, crR, ly, stair, tr, trL, trR, vt, wkF, wkL, wkR, balance, buttUp, calib, cd1, cd2, dropped, lifted, pee, pee1, pu1, pu2, rc1, rc10, rc2, rc3, rc4, rc5, rc6, rc7, rc8, rc9, rest, sit, sleep, str, zero, fistbump, restlaidout};
 #else	//only need to know the pointers to newbilities, because the intuitions have been saved onto external EEPROM,
 	//while the newbilities on progmem are assigned to new addresses
   const char* progmemPointer[] = {stair, };
@@ -10,8 +10,6 @@
 #include <Arduino.h>
 #endif  // TESTING
 
-#include <string.h>
-
 #include "prng.h"
 #include "servo_animator.h"
 
@@ -63,6 +61,7 @@ static AutoMode::StateData s_state_data[kStateCount] = {
 void AutoMode::Initialize(ServoAnimator* animator, PRNG* prng) {
   state_data_ = s_state_data;
   servo_animator_ = animator;
+  servo_animator_->set_observer(this);
   prng_ = prng;
 }
 
@@ -71,6 +70,8 @@ void AutoMode::SetEnabled(bool enabled) {
   if (enabled == enabled_) return;
 
   millis_next_state_ = 0;
+  posed_ = false;
+  servo_animator_->ClearLayer(kLayerLookAround);
   if (!enabled) {
     servo_animator_->set_ms_per_degree(saved_ms_per_degree_);
   } else {
@@ -84,23 +85,22 @@ void AutoMode::SetEnabled(bool enabled) {
   enabled_ = enabled;
 }
 
+void AutoMode::OnAnimationDone(int animation) {
+  if (enabled_ && animation == state_data_[state_].animation_sequence)
+    posed_ = true;
+}
+
 void AutoMode::LookAround(unsigned long millis_now) {
   if (millis_next_look_around_) {
     if (millis_now < millis_next_look_around_) {
       return;
     }
 
-    int8_t new_frame[kServoCount];
-    const int8_t* frame = servo_animator_->GetFrame(
-        state_data_[state_].animation_sequence, 0);
-    memcpy(new_frame, frame, sizeof(new_frame));
-
-    new_frame[kServoHead] =
-        ServoAnimator::AngleAdd(frame[kServoHead], 50 - prng_->Roll(100));
-    new_frame[kServoNeck] =
-        ServoAnimator::AngleAdd(frame[kServoNeck], 70 - prng_->Roll(140));
-    servo_animator_->set_ms_per_degree(10);
-    servo_animator_->StartFrame(new_frame, millis_now);
+    // Glances move only the head and neck, on top of the held pose.
+    servo_animator_->SetLayerOffset(kLayerLookAround, kServoHead,
+                                    50 - prng_->Roll(100));
+    servo_animator_->SetLayerOffset(kLayerLookAround, kServoNeck,
+                                    70 - prng_->Roll(140));
   }
   int millis_next = 4000 - prng_->Roll(3500);
   millis_next_look_around_ = millis_now + millis_next;
@@ -114,8 +114,7 @@ void AutoMode::Update(unsigned long millis_now) {
     return;
 
   if (millis_next_state_ && millis_now < millis_next_state_) {
-    if (!servo_animator_->animating() && look_around_enabled_ && 
-          state_data_[state_].look_around)
+    if (posed_ && look_around_enabled_ && state_data_[state_].look_around)
       LookAround(millis_now);
     return;
   }
@@ -164,6 +163,8 @@ void AutoMode::Update(unsigned long millis_now) {
   Serial.println(ms_per_degree);
 #endif  // TESTING
   servo_animator_->set_ms_per_degree(ms_per_degree);
-  servo_animator_->StartAnimation(new_animation, millis_now);
+  servo_animator_->ClearLayer(kLayerLookAround);
+  servo_animator_->StopAtStableFrame(new_animation, millis_now);
+  posed_ = false;
   millis_next_look_around_ = 0;
 }
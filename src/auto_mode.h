@@ -1,7 +1,8 @@
 #ifndef _AUTO_MODE_H
 #define _AUTO_MODE_H
 
-class ServoAnimator;
+#include "servo_animator.h"
+
 class PRNG;
 
 enum AutoModeState {
@@ -14,7 +15,7 @@ enum AutoModeState {
   kStateCount
 };
 
-class AutoMode {
+class AutoMode : public AnimationObserver {
  public:
   struct StateData {
     char next_state_prob[kStateCount];
@@ -35,6 +36,8 @@ class AutoMode {
   void SetLookAroundEnabled(bool enabled) {
     look_around_enabled_ = enabled;
   }
+  // Glances start once the animation of the state is done.
+  void OnAnimationDone(int animation) override;
 
 #ifdef TESTING
   void SetStateData(StateData* data) {
@@ -53,6 +56,7 @@ class AutoMode {
   unsigned long millis_next_state_ = 0;
   StateData* state_data_;
 
+  bool posed_ = false;
   unsigned long millis_next_look_around_ = 0;
   bool look_around_enabled_ = true;
 };
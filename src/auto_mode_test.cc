@@ -118,4 +118,27 @@ TEST_F(AutoModeTest, SequentialTransitions) {
   ASSERT_EQ(kStateBalance, auto_mode_.GetState());
 
   ASSERT_TRUE(auto_mode_.enabled());
-}
\ No newline at end of file
+}
+
+TEST_F(AutoModeTest, LookAroundWaitsForThePose) {
+  auto_mode_.SetLookAroundEnabled(true);
+  auto_mode_.SetEnabled(true);
+  // Balance for 10 - 5 seconds.
+  prng_list_ = { 60, 0 };
+  auto_mode_.Update(1);
+  ASSERT_EQ(kStateBalance, auto_mode_.GetState());
+  // Not posed yet, so no glance is scheduled.
+  auto_mode_.Update(2);
+  EXPECT_TRUE(prng_list_.empty());
+
+  auto_mode_.OnAnimationDone(kAnimationSit);
+  auto_mode_.Update(3);
+  EXPECT_TRUE(prng_list_.empty());
+  prng_list_ = { 0, 10, 20, 0 };
+  auto_mode_.OnAnimationDone(kAnimationBalance);
+  auto_mode_.Update(4);
+  auto_mode_.Update(4004);
+  EXPECT_TRUE(prng_list_.empty());
+  EXPECT_EQ(40, animator_.layer_offset(kLayerLookAround, kServoHead));
+  EXPECT_EQ(50, animator_.layer_offset(kLayerLookAround, kServoNeck));
+}
@@ -0,0 +1,79 @@
+#include "balance_controller.h"
+
+#include <string.h>
+
+static const int32_t kMaxCorrectionQ4 = int32_t(kMaxBalanceCorrection) << 4;
+static const int32_t kMaxIntegral = kMaxCorrectionQ4 << 12;
+
+int BalanceController::Update(const BalanceGains& gains, int tilt,
+                              unsigned int elapsed_ms) {
+  if (!primed_) {
+    last_tilt_ = tilt;
+    elapsed_ms = kBalanceStepMs;
+    primed_ = true;
+  }
+  if (elapsed_ms > kMaxBalanceStepMs)
+    elapsed_ms = kMaxBalanceStepMs;
+  // Q8 terms, brought to Q4 below. Samples taken in the same ms keep the
+  // last derivative, and the next one covers their change.
+  int32_t proportional = int32_t(gains.kp) * tilt;
+  if (elapsed_ms > 0) {
+    derivative_ = int32_t(gains.kd) * (tilt - last_tilt_) *
+        int32_t(kBalanceStepMs) / int32_t(elapsed_ms);
+    last_tilt_ = tilt;
+  }
+  int32_t fast = (proportional + derivative_) >> 4;
+
+  int32_t step = int32_t(gains.ki) * tilt * int32_t(elapsed_ms) /
+      int32_t(kBalanceStepMs);
+  int32_t unclamped = fast + (integral_ >> 12);
+  bool saturated = (unclamped >= kMaxCorrectionQ4 && step > 0) ||
+      (unclamped <= -kMaxCorrectionQ4 && step < 0);
+  if (!saturated) {
+    integral_ += step;
+    if (integral_ > kMaxIntegral)
+      integral_ = kMaxIntegral;
+    if (integral_ < -kMaxIntegral)
+      integral_ = -kMaxIntegral;
+  }
+
+  int32_t correction = fast + (integral_ >> 12);
+  if (correction > kMaxCorrectionQ4)
+    correction = kMaxCorrectionQ4;
+  if (correction < -kMaxCorrectionQ4)
+    correction = -kMaxCorrectionQ4;
+  correction_ = correction;
+  return correction_;
+}
+
+void BalanceController::Reset() {
+  integral_ = 0;
+  derivative_ = 0;
+  last_tilt_ = 0;
+  correction_ = 0;
+  primed_ = false;
+}
+
+// In ServoIndex order. Shoulders lean back and knees straighten against
+// pitch; on a roll the legs on the low side move more.
+static const int8_t kDefaultPitchMix[kNumServos] = {
+  16, 0, 0, -14, -14, -14, -14, 21, 21, 21, 21
+};
+static const int8_t kDefaultRollLeftMix[kNumServos] = {
+  0, -16, -32, 16, 24, -24, -16, -22, -34, 34, 22
+};
+static const int8_t kDefaultRollRightMix[kNumServos] = {
+  0, -16, -32, -24, -16, 16, 24, 34, 22, -22, -34
+};
+
+void SetDefaultBalanceSettings(EepromSettings* settings) {
+  const BalanceGains kDefaultGains = { 16, 164, 0 };
+  settings->pitch_gains = kDefaultGains;
+  settings->roll_gains = kDefaultGains;
+  memcpy(settings->balance_pitch_mix, kDefaultPitchMix,
+         sizeof(kDefaultPitchMix));
+  memcpy(settings->balance_roll_left_mix, kDefaultRollLeftMix,
+         sizeof(kDefaultRollLeftMix));
+  memcpy(settings->balance_roll_right_mix, kDefaultRollRightMix,
+         sizeof(kDefaultRollRightMix));
+}
@@ -0,0 +1,44 @@
+#ifndef _BALANCE_CONTROLLER_H
+#define _BALANCE_CONTROLLER_H
+
+#include <stdint.h>
+
+#include "eeprom_settings.h"
+
+// Largest balance correction, in degrees.
+static const int kMaxBalanceCorrection = 40;
+// The period that the integral and derivative gains are given for.
+static const unsigned int kBalanceStepMs = 10;
+// Longest gap between samples that the integral and derivative account for.
+static const unsigned int kMaxBalanceStepMs = 100;
+
+// Fixed-point PID controller for one tilt axis, fed samples at any rate.
+// Tilts and corrections are in Q4 degrees; the correction levels the body
+// when the joints move by it times the balance mix of EepromSettings. The
+// derivative acts on the measured tilt so that it ignores resets. The
+// integral stops growing while the correction is at kMaxBalanceCorrection in
+// the direction of the tilt, and is itself clamped to that range, so that a
+// long saturation does not wind it up.
+class BalanceController {
+ public:
+  BalanceController() {}
+
+  // Returns the correction for the tilt sample, taken elapsed_ms after the
+  // last one. The first sample after Reset counts as kBalanceStepMs.
+  int Update(const BalanceGains& gains, int tilt, unsigned int elapsed_ms);
+  void Reset();
+  int correction() const { return correction_; }
+
+ private:
+  int32_t integral_ = 0;  // Q16 degrees.
+  int32_t derivative_ = 0;  // Q8 degrees.
+  int16_t last_tilt_ = 0;
+  int16_t correction_ = 0;
+  bool primed_ = false;
+};
+
+// Fills in the balance gains and mix tables with values that reproduce the
+// earlier fixed coefficients, plus integral action.
+void SetDefaultBalanceSettings(EepromSettings* settings);
+
+#endif  // _BALANCE_CONTROLLER_H
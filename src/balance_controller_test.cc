@@ -0,0 +1,156 @@
+#include "balance_controller.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <gtest/gtest.h>
+
+static const int kSampleMs = 10;
+
+TEST(BalanceControllerTest, ProportionalAndIntegral) {
+  BalanceController controller;
+  const BalanceGains kGains = { 16, 0, 0 };
+  EXPECT_EQ(10 * 16, controller.Update(kGains, 10 * 16, kSampleMs));
+  EXPECT_EQ(-5 * 16, controller.Update(kGains, -5 * 16, kSampleMs));
+
+  // 1/32 of the tilt per sample.
+  const BalanceGains kIntegral = { 0, 128, 0 };
+  controller.Reset();
+  for (int i = 1; i <= 32; ++i)
+    EXPECT_EQ(i / 2, controller.Update(kIntegral, 16, kSampleMs));
+}
+
+TEST(BalanceControllerTest, DerivativeActsOnChangesOnly) {
+  BalanceController controller;
+  const BalanceGains kGains = { 0, 0, 32 };
+  // The first sample has nothing to differentiate against.
+  EXPECT_EQ(0, controller.Update(kGains, 20 * 16, kSampleMs));
+  EXPECT_EQ(2 * 16, controller.Update(kGains, 21 * 16, kSampleMs));
+  EXPECT_EQ(0, controller.Update(kGains, 21 * 16, kSampleMs));
+  EXPECT_EQ(-4 * 16, controller.Update(kGains, 19 * 16, kSampleMs));
+}
+
+// However the samples of a tilt are spread out, the gains hold per
+// kBalanceStepMs.
+TEST(BalanceControllerTest, GainsHoldAtAnySampleRate) {
+  const BalanceGains kIntegral = { 0, 128, 0 };
+  const BalanceGains kDerivative = { 0, 0, 32 };
+  for (unsigned int step_ms : { 5u, 10u, 20u, 40u }) {
+    BalanceController integral;
+    BalanceController derivative;
+    integral.Update(kIntegral, 0, step_ms);
+    derivative.Update(kDerivative, 0, step_ms);
+    for (unsigned int ms = step_ms; ms <= 200; ms += step_ms) {
+      // 4 degrees held for 200ms add 20 steps of 1/32 of it.
+      integral.Update(kIntegral, 4 * 16, step_ms);
+      // A 2 degree per 10ms ramp, which kd doubles.
+      derivative.Update(kDerivative, ms * 32 / 10, step_ms);
+    }
+    EXPECT_EQ(40, integral.correction()) << step_ms << "ms";
+    EXPECT_EQ(4 * 16, derivative.correction()) << step_ms << "ms";
+  }
+
+  // Samples drained in the same ms count once time has passed.
+  BalanceController controller;
+  controller.Update(kDerivative, 0, 10);
+  controller.Update(kDerivative, 16, 10);
+  EXPECT_EQ(2 * 16, controller.Update(kDerivative, 48, 0));
+  EXPECT_EQ(6 * 16, controller.Update(kDerivative, 64, 10));
+}
+
+TEST(BalanceControllerTest, IntegralDoesNotWindUp) {
+  BalanceController controller;
+  const BalanceGains kGains = { 16, 255, 0 };
+  // A long 30 degree tilt saturates the output once the integral adds the
+  // missing 10 degrees, and the integral stops there.
+  for (int i = 0; i < 1000; ++i)
+    controller.Update(kGains, 30 * 16, kSampleMs);
+  EXPECT_EQ(kMaxBalanceCorrection * 16, controller.correction());
+  // So a level body brings the correction down at once rather than after
+  // unwinding 1000 samples.
+  int correction = controller.Update(kGains, 0, kSampleMs);
+  EXPECT_GT(correction, 0);
+  // The last sample before saturating may overshoot by one step.
+  EXPECT_LE(correction, (kMaxBalanceCorrection - 30) * 16 + 32);
+  correction = controller.Update(kGains, -20 * 16, kSampleMs);
+  EXPECT_LT(correction, 0);
+}
+
+// A body standing on ground that tilts by ground degrees. Joint corrections
+// reach the commanded value at the balance layer's slew rate and level the
+// body by kEffect of the correction, with some lag.
+class TiltPlant {
+ public:
+  static constexpr double kEffect = .6;
+  static constexpr double kLagMs = 50;
+
+  explicit TiltPlant(double ground) : ground_(ground), tilt_(ground) {}
+
+  void Step(double commanded, double degrees_per_ms) {
+    double slew = degrees_per_ms * kSampleMs;
+    applied_ += fmax(-slew, fmin(slew, commanded - applied_));
+    double target = ground_ - kEffect * applied_;
+    tilt_ += (target - tilt_) * kSampleMs / kLagMs;
+  }
+
+  double tilt() const { return tilt_; }
+
+ private:
+  double ground_;
+  double tilt_;
+  double applied_ = 0;
+};
+
+struct Response {
+  int settling_ms;  // After which the tilt stays within 1 degree.
+  double overshoot;  // Largest tilt past level, in percent of the step.
+  double final_tilt;
+};
+
+static Response Measure(double ground, bool closed_loop) {
+  const int kSamples = 800;
+  TiltPlant plant(ground);
+  BalanceController controller;
+  EepromSettings settings;
+  SetDefaultBalanceSettings(&settings);
+  int last_correction = 0;
+  Response response = { 0, 0, 0 };
+  for (int sample = 1; sample <= kSamples; ++sample) {
+    int measured = int(plant.tilt());
+    double commanded;
+    if (closed_loop) {
+      int correction = controller.Update(settings.pitch_gains,
+                                         lround(plant.tilt() * 16), kSampleMs);
+      commanded = correction / 16.0;
+      // The balance layer's 2ms per degree.
+      plant.Step(commanded, .5);
+    } else {
+      // HandlePitchRoll before the controller: whole degrees applied in
+      // 10 degree steps, played as a segment at 4ms per degree.
+      if (abs(measured - last_correction) >= 10)
+        last_correction = measured;
+      commanded = last_correction;
+      plant.Step(commanded, .25);
+    }
+    if (fabs(plant.tilt()) > 1)
+      response.settling_ms = sample * kSampleMs;
+    response.overshoot = fmax(response.overshoot,
+                              -plant.tilt() / ground * 100);
+  }
+  response.final_tilt = plant.tilt();
+  return response;
+}
+
+TEST(BalanceControllerTest, LevelsASlopeBetterThanFixedCoefficients) {
+  for (double ground : { 5.0, 10.0, 20.0 }) {
+    Response fixed = Measure(ground, false);
+    Response pid = Measure(ground, true);
+    printf("%.0f degree slope: fixed settles %dms, %.1f%% overshoot, "
+           "%.1f degrees left; PID settles %dms, %.1f%% overshoot, "
+           "%.1f degrees left\n", ground, fixed.settling_ms, fixed.overshoot,
+           fixed.final_tilt, pid.settling_ms, pid.overshoot, pid.final_tilt);
+    EXPECT_LT(fabs(pid.final_tilt), .5);
+    EXPECT_LT(fabs(pid.final_tilt), fabs(fixed.final_tilt));
+    EXPECT_LT(pid.settling_ms, 3000);
+    EXPECT_LT(pid.overshoot, 10);
+  }
+}
@@ -11,6 +11,7 @@ static const float kTau = 500;
 static EepromSettingsManager s_eeprom_settings;
 static ServoAnimator s_servo_animator;
 #ifdef MPU
+static TwiBus s_twi;
 static MPU6050 s_mpu(kMpuI2CAddr, kTau / 1000, kDt / 1000);
 #endif  // MPU
 static bool s_balance_enabled;
@@ -182,6 +183,8 @@ class ServoValueMenu : public MenuObserver {
         *value_ *= -1;
     }
     if (*value_ != old_value) {
+      // The value may be a zero offset or extent in the settings.
+      s_servo_animator.EepromSettingsChanged();
       StartFrame();
     }
   }
@@ -436,7 +439,7 @@ static void CalibrateMPU() {
 static void SetBalanceEnabled(bool enabled) {
   s_balance_enabled = enabled;
   if (!enabled)
-    s_servo_animator.HandlePitchRoll(0, 0, millis());
+    s_servo_animator.ResetBalance();
 }
 
 static void StreamMPU() {
@@ -472,20 +475,19 @@ static void SetPose() {
 
   class PoseMenu : public MenuObserver {
    public:
-    PoseMenu(int animation) : animation_(animation) {
-      total_frames_ = 1;
-      while (s_servo_animator.GetFrame(animation_, total_frames_) != nullptr)
-        ++total_frames_;
+    PoseMenu(int animation) {
+      cursor_.Open(animation);
+      total_frames_ = cursor_.frame_count();
     }
 
     void Show() override {
-      if (total_frames_ == 1)
+      if (total_frames_ <= 1)
         return;
       ShowByte(current_frame_);
     }
 
     void HandleKey(char key) override {
-      if (total_frames_ == 1)
+      if (total_frames_ <= 1)
         return;
       if (key == kKeyUp) {
         current_frame_++;
@@ -501,15 +503,16 @@ static void SetPose() {
     }
 
     bool HandleSelection() override {
-      s_servo_animator.StartFrame(s_servo_animator.
-          GetFrame(animation_, current_frame_), millis());
+      int8_t frame[kServoCount];
+      if (cursor_.Read(current_frame_, frame))
+        s_servo_animator.StartFrame(frame, millis());
       return false;
     }
 
     ~PoseMenu() override {}
 
    protected:
-    int animation_;
+    FrameCursor cursor_;
     int total_frames_ = 0;
     int current_frame_ = 0;
   };
@@ -568,7 +571,8 @@ int main() {
   s_servo_animator.SetEepromSettings(&s_eeprom_settings.settings());
   s_servo_animator.set_ms_per_degree(2);
 #ifdef MPU
-  s_mpu.Initialize();
+  s_twi.Begin();
+  s_mpu.Initialize(&s_twi);
   s_mpu.SetGyroCorrection(s_eeprom_settings.settings().gyro_correction);
   s_mpu.SetPitchRollCorrection(s_eeprom_settings.settings().pitch_correction,
                                s_eeprom_settings.settings().roll_correction);
@@ -625,7 +629,8 @@ void yield() {
     s_mpu.ReadBoth(accel, gyro);
     float pitch, roll;
     s_mpu.ComputeFilteredPitchRoll(accel, gyro, &pitch, &roll);
-    s_servo_animator.HandlePitchRoll(pitch, roll, millis_now);
+    s_servo_animator.HandlePitchRoll(pitch * kAngleOne, roll * kAngleOne,
+                                     millis_now);
   }
 #endif  // MPU
 
@@ -0,0 +1,71 @@
+#include "easing.h"
+
+#ifndef TESTING
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_word(_a) (*(_a))
+#endif  // TESTING
+
+// (1 - cos(i * PI / 64)) / 2 in Q15 for i in [0, 64].
+static const int kEaseTableBits = 6;
+static const int kEaseFractionBits = 15 - kEaseTableBits;
+static const uint16_t kEaseTable[(1 << kEaseTableBits) + 1] PROGMEM = {
+      0,    20,    79,   177,   315,   491,   705,   958,
+   1247,  1573,  1935,  2331,  2761,  3224,  3719,  4244,
+   4799,  5381,  5990,  6624,  7282,  7961,  8661,  9379,
+  10114, 10864, 11628, 12403, 13188, 13980, 14778, 15580,
+  16384, 17188, 17990, 18788, 19580, 20365, 21140, 21904,
+  22654, 23389, 24107, 24807, 25486, 26144, 26778, 27387,
+  27969, 28524, 29049, 29544, 30007, 30437, 30833, 31195,
+  31521, 31810, 32063, 32277, 32453, 32591, 32689, 32748,
+  32768,
+};
+
+uint32_t PortionReciprocal(unsigned int ms) {
+  if (ms == 0)
+    return 0;
+  return (uint32_t(kQ15One) << 16) / ms;
+}
+
+uint16_t PortionQ15(unsigned long elapsed, unsigned int ms,
+                    uint32_t reciprocal) {
+  if (elapsed >= ms)
+    return kQ15One;
+  // elapsed < ms, so the product stays below 2^31.
+  return (uint32_t(elapsed) * reciprocal) >> 16;
+}
+
+uint16_t EaseCosineQ15(uint16_t portion) {
+  if (portion >= kQ15One)
+    return kQ15One;
+  uint8_t index = portion >> kEaseFractionBits;
+  uint16_t fraction = portion & ((1 << kEaseFractionBits) - 1);
+  uint16_t low = pgm_read_word(&kEaseTable[index]);
+  uint16_t high = pgm_read_word(&kEaseTable[index + 1]);
+  return low + ((uint32_t(high - low) * fraction) >> kEaseFractionBits);
+}
+
+int ScaleQ15(int delta, uint16_t fraction) {
+  if (delta < 0)
+    return -ScaleQ15(-delta, fraction);
+  return (int32_t(delta) * fraction + (kQ15One >> 1)) >> 15;
+}
+
+int HermiteQ15(int delta, int tangent_start, int tangent_end,
+               uint16_t portion) {
+  if (portion >= kQ15One)
+    return delta;
+  int32_t t = portion;
+  int32_t t2 = (t * t) >> 15;
+  int32_t t3 = (t2 * t) >> 15;
+  // Basis functions of the end point and the two tangents, in Q15.
+  int32_t end = 3 * t2 - 2 * t3;
+  int32_t start_slope = t3 - 2 * t2 + t;
+  int32_t end_slope = t3 - t2;
+  int32_t sum = int32_t(delta) * end + int32_t(tangent_start) * start_slope +
+      int32_t(tangent_end) * end_slope;
+  if (sum < 0)
+    return -((-sum + (kQ15One >> 1)) >> 15);
+  return (sum + (kQ15One >> 1)) >> 15;
+}
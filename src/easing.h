@@ -0,0 +1,30 @@
+#ifndef _EASING_H
+#define _EASING_H
+
+#include <stdint.h>
+
+// Integer-only helpers for easing servo motions. Fractions in [0, 1] are
+// carried as Q15 fixed point so that no soft-float calls are needed on AVR.
+
+static const uint16_t kQ15One = 1U << 15;
+
+// Returns the reciprocal of ms used by PortionQ15 to avoid a divide per tick.
+uint32_t PortionReciprocal(unsigned int ms);
+
+// Returns elapsed / ms as Q15, saturated at kQ15One.
+uint16_t PortionQ15(unsigned long elapsed, unsigned int ms,
+                    uint32_t reciprocal);
+
+// Returns (1 - cos(portion * PI)) / 2 as Q15 for a Q15 portion.
+uint16_t EaseCosineQ15(uint16_t portion);
+
+// Returns delta * fraction rounded half away from zero.
+int ScaleQ15(int delta, uint16_t fraction);
+
+// Returns the offset from its start of a cubic Hermite segment that moves
+// delta, at a Q15 portion of the segment. The tangents are the velocities at
+// either end in delta units per whole segment; both 0 gives smoothstep.
+int HermiteQ15(int delta, int tangent_start, int tangent_end,
+               uint16_t portion);
+
+#endif  // _EASING_H
@@ -0,0 +1,139 @@
+#include "easing.h"
+
+#include <chrono>
+#include <math.h>
+#include <gtest/gtest.h>
+
+// The float path ServoAnimator used before the Q15 path.
+static int FloatAngleMotion(unsigned long elapsed, int total_angle_motion,
+                            int ms_for_angle_motion) {
+  float portion_done;
+  if (ms_for_angle_motion == 0) {
+    portion_done = 1;
+  } else {
+    portion_done = (float)elapsed / ms_for_angle_motion;
+    if (portion_done > 1.0) portion_done = 1;
+  }
+  float portion_done_smoothed = (1 - cos(portion_done * M_PI)) / 2;
+  if (total_angle_motion > 0)
+    return portion_done_smoothed * total_angle_motion + .5;
+  return portion_done_smoothed * total_angle_motion - .5;
+}
+
+static int FixedAngleMotion(unsigned long elapsed, int total_angle_motion,
+                            int ms_for_angle_motion, uint32_t reciprocal) {
+  uint16_t portion = PortionQ15(elapsed, ms_for_angle_motion, reciprocal);
+  return ScaleQ15(total_angle_motion, EaseCosineQ15(portion));
+}
+
+TEST(EasingTest, PortionEndpoints) {
+  uint32_t reciprocal = PortionReciprocal(60);
+  EXPECT_EQ(0, PortionQ15(0, 60, reciprocal));
+  EXPECT_NEAR(kQ15One / 2, PortionQ15(30, 60, reciprocal), 1);
+  EXPECT_EQ(kQ15One, PortionQ15(60, 60, reciprocal));
+  EXPECT_EQ(kQ15One, PortionQ15(1000, 60, reciprocal));
+  EXPECT_EQ(kQ15One, PortionQ15(0, 0, PortionReciprocal(0)));
+}
+
+TEST(EasingTest, EaseEndpoints) {
+  EXPECT_EQ(0, EaseCosineQ15(0));
+  EXPECT_EQ(kQ15One / 2, EaseCosineQ15(kQ15One / 2));
+  EXPECT_EQ(kQ15One, EaseCosineQ15(kQ15One));
+}
+
+TEST(EasingTest, EaseIsMonotonic) {
+  uint16_t last = 0;
+  for (uint32_t portion = 0; portion <= kQ15One; ++portion) {
+    uint16_t eased = EaseCosineQ15(portion);
+    ASSERT_GE(eased, last) << "portion " << portion;
+    last = eased;
+  }
+}
+
+TEST(EasingTest, ScaleRoundsAwayFromZero) {
+  EXPECT_EQ(1, ScaleQ15(1, kQ15One / 2));
+  EXPECT_EQ(-1, ScaleQ15(-1, kQ15One / 2));
+  EXPECT_EQ(0, ScaleQ15(1, kQ15One / 2 - 1));
+  EXPECT_EQ(-255, ScaleQ15(-255, kQ15One));
+}
+
+TEST(EasingTest, MatchesFloatPathWithinOneDegree) {
+  int mismatches = 0;
+  for (int ms_per_degree = 1; ms_per_degree <= 10; ++ms_per_degree) {
+    for (int delta = -255; delta <= 255; ++delta) {
+      int ms = abs(delta) * ms_per_degree;
+      uint32_t reciprocal = PortionReciprocal(ms);
+      for (int elapsed = 0; elapsed <= ms + 1; ++elapsed) {
+        int expected = FloatAngleMotion(elapsed, delta, ms);
+        int actual = FixedAngleMotion(elapsed, delta, ms, reciprocal);
+        ASSERT_NEAR(expected, actual, 1)
+            << "delta " << delta << " at " << elapsed << "/" << ms << "ms";
+        if (expected != actual)
+          ++mismatches;
+      }
+    }
+  }
+  printf("Easing mismatches=%d\n", mismatches);
+}
+
+static double FloatHermite(double delta, double tangent_start,
+                           double tangent_end, double t) {
+  return delta * (3 * t * t - 2 * t * t * t) +
+      tangent_start * (t * t * t - 2 * t * t + t) +
+      tangent_end * (t * t * t - t * t);
+}
+
+TEST(EasingTest, HermiteEndpoints) {
+  EXPECT_EQ(0, HermiteQ15(100, 50, -50, 0));
+  EXPECT_EQ(100, HermiteQ15(100, 50, -50, kQ15One));
+  EXPECT_EQ(-100, HermiteQ15(-100, 50, -50, kQ15One));
+  EXPECT_EQ(50, HermiteQ15(100, 0, 0, kQ15One / 2));
+  // With no motion the tangents alone bulge the path.
+  EXPECT_EQ(18, HermiteQ15(0, 120, 0, kQ15One / 3));
+}
+
+TEST(EasingTest, HermiteMatchesFloat) {
+  const int kTangents[] = { -255, -60, 0, 37, 255 };
+  for (int delta = -255; delta <= 255; delta += 5) {
+    for (int tangent_start : kTangents) {
+      for (int tangent_end : kTangents) {
+        for (uint32_t portion = 0; portion <= kQ15One; portion += 512) {
+          double expected = FloatHermite(delta, tangent_start, tangent_end,
+                                         double(portion) / kQ15One);
+          ASSERT_NEAR(expected, HermiteQ15(delta, tangent_start, tangent_end,
+                                           portion), 1)
+              << delta << " " << tangent_start << " " << tangent_end
+              << " at " << portion;
+        }
+      }
+    }
+  }
+}
+
+TEST(EasingTest, Benchmark) {
+  const int kDelta = 75;
+  const int kMs = kDelta * 4;
+  const int kRounds = 2000;
+  volatile int sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (int elapsed = 0; elapsed < kMs; ++elapsed)
+      sink = sink + FloatAngleMotion(elapsed, kDelta, kMs);
+  }
+  auto float_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  uint32_t reciprocal = PortionReciprocal(kMs);
+  for (int round = 0; round < kRounds; ++round) {
+    for (int elapsed = 0; elapsed < kMs; ++elapsed)
+      sink = sink + FixedAngleMotion(elapsed, kDelta, kMs, reciprocal);
+  }
+  auto fixed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  printf("Easing float=%.2fns/call, Q15=%.2fns/call\n",
+         double(float_ns) / (kRounds * kMs),
+         double(fixed_ns) / (kRounds * kMs));
+}
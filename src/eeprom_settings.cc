@@ -3,7 +3,12 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 
-static const char kEepromSignature[] = "eM1";
+#include "balance_controller.h"
+
+static const char kEepromSignature[] = "eM2";
+// Settings before the balance controller, which are a prefix of the current
+// ones.
+static const char kEepromSignatureV1[] = "eM1";
 
 void EepromSettingsManager::Initialize() {
   EEPROM.get(0, settings_);
@@ -11,8 +16,14 @@ void EepromSettingsManager::Initialize() {
   	return;
   }
 
-  Serial.println("Creating zeroed settings");
-  memset(&settings_, 0, sizeof(settings_));
+  if (memcmp(&settings_.signature, kEepromSignatureV1,
+             strlen(kEepromSignatureV1)) == 0) {
+    Serial.println("Adding balance settings");
+  } else {
+    Serial.println("Creating zeroed settings");
+    memset(&settings_, 0, sizeof(settings_));
+  }
+  SetDefaultBalanceSettings(&settings_);
   memcpy(&settings_.signature, kEepromSignature, strlen(kEepromSignature));
   EEPROM.put(0, settings_);
 }
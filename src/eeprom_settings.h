@@ -5,6 +5,13 @@
 
 static const int kNumServos = 11;
 
+// Gains of one axis of the balance controller, see BalanceController.
+struct BalanceGains {
+  uint8_t kp;  // Q4.
+  uint8_t ki;  // Q12, per kBalanceStepMs.
+  uint8_t kd;  // Q4, per kBalanceStepMs.
+};
+
 struct EepromSettings {
   uint8_t signature[3];
 
@@ -15,6 +22,15 @@ struct EepromSettings {
   int16_t gyro_correction[3];
   int16_t pitch_correction;
   int16_t roll_correction;
+
+  BalanceGains pitch_gains;
+  BalanceGains roll_gains;
+  // Degrees each joint moves per degree of balance correction, in Q4. Roll
+  // has one table for leaning left, where the correction is positive, and
+  // one for leaning right.
+  int8_t balance_pitch_mix[kNumServos];
+  int8_t balance_roll_left_mix[kNumServos];
+  int8_t balance_roll_right_mix[kNumServos];
 };
 
 class EepromSettingsManager {
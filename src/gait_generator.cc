@@ -0,0 +1,141 @@
+#include "gait_generator.h"
+
+#include <stdlib.h>
+
+#ifndef TESTING
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(_a) (*(_a))
+#endif  // TESTING
+
+#include "easing.h"
+
+// Neutral pose and phase offset of each leg, in the order of the shoulders
+// in ServoIndex. The pose is the average of the wkF frames; the offsets give
+// the right back, right front, left back, left front footfall order of a
+// walk.
+struct LegParams {
+  int8_t shoulder;
+  int8_t knee;
+  uint8_t phase_offset;  // Fraction of the cycle in Q8.
+  bool left;
+};
+
+static const LegParams kLegParams[kGaitLegs] PROGMEM = {
+  { 47, 6, 192, true },     // kServoLeftFrontShoulder
+  { 48, 6, 64, false },     // kServoRightFrontShoulder
+  { -51, -7, 0, false },    // kServoRightBackShoulder
+  { -51, -8, 128, true },   // kServoLeftBackShoulder
+};
+
+static const int kKneeLift = 20;
+
+void GaitGenerator::set_stride(int stride) {
+  if (stride > kMaxGaitStride)
+    stride = kMaxGaitStride;
+  if (stride < -kMaxGaitStride)
+    stride = -kMaxGaitStride;
+  stride_ = stride;
+}
+
+void GaitGenerator::set_turn(int turn) {
+  if (turn > kMaxGaitTurn)
+    turn = kMaxGaitTurn;
+  if (turn < -kMaxGaitTurn)
+    turn = -kMaxGaitTurn;
+  turn_ = turn;
+}
+
+void GaitGenerator::set_frames_per_cycle(uint8_t frames) {
+  if (frames < 2)
+    frames = 2;
+  // Keep the current phase so that a change of pace does not jerk the legs.
+  step_ = (uint32_t(phase_) * frames) >> 16;
+  frames_per_cycle_ = frames;
+}
+
+void GaitGenerator::Reset() {
+  set_step(0);
+}
+
+void GaitGenerator::set_step(uint8_t step) {
+  step_ = step < frames_per_cycle_ ? step : 0;
+  // Computed from the step rather than accumulated so that it never drifts.
+  phase_ = (uint32_t(step_) << 16) / frames_per_cycle_;
+}
+
+void GaitGenerator::Next(int8_t* frame) {
+  ComputeFrame(phase_, frame);
+  set_step(step_ + 1);
+}
+
+// Largest distance of a leg joint at step of the GaitGenerator in context
+// from its neutral pose.
+static int StepDistance(uint8_t step, const void* context) {
+  const GaitGenerator* gait = static_cast<const GaitGenerator*>(context);
+  int8_t frame[kServoCount];
+  gait->ComputeFrame((uint32_t(step) << 16) / gait->frames_per_cycle(), frame);
+  int distance = 0;
+  for (int leg = 0; leg < kGaitLegs; ++leg) {
+    const LegParams* params = &kLegParams[leg];
+    int shoulder = abs(frame[kServoLeftFrontShoulder + leg] -
+                       int8_t(pgm_read_byte(&params->shoulder)));
+    int knee = abs(frame[kServoLeftFrontKnee + leg] -
+                   int8_t(pgm_read_byte(&params->knee)));
+    if (shoulder > distance)
+      distance = shoulder;
+    if (knee > distance)
+      distance = knee;
+  }
+  return distance;
+}
+
+void GaitGenerator::StableSteps(uint8_t* steps) const {
+  PickStableFrames(frames_per_cycle_, StepDistance, this, steps);
+}
+
+void GaitGenerator::ComputeFrame(uint16_t phase, int8_t* frame) const {
+  frame[kServoHead] = 0;
+  frame[kServoNeck] = 0;
+  frame[kServoTail] = 0;
+  // Turning shortens the stride on the inside of the turn.
+  int inner_stride = stride_ * (kMaxGaitTurn - abs(turn_)) / kMaxGaitTurn;
+  int left_stride = turn_ < 0 ? inner_stride : stride_;
+  int right_stride = turn_ > 0 ? inner_stride : stride_;
+  for (int leg = 0; leg < kGaitLegs; ++leg) {
+    bool left = pgm_read_byte(&kLegParams[leg].left);
+    ComputeLeg(leg, phase, left ? left_stride : right_stride, frame);
+  }
+}
+
+void GaitGenerator::ComputeLeg(int leg, uint16_t phase, int stride,
+                               int8_t* frame) const {
+  const LegParams* params = &kLegParams[leg];
+  uint8_t phase_offset = pgm_read_byte(&params->phase_offset);
+  int neutral_shoulder = int8_t(pgm_read_byte(&params->shoulder));
+  uint16_t leg_phase = phase + (uint16_t(phase_offset) << 8);
+  uint32_t stance = uint32_t(duty_factor_) << 8;
+  int shoulder;
+  int knee = int8_t(pgm_read_byte(&params->knee));
+
+  if (leg_phase < stance) {
+    // On the ground: sweep at constant speed to push the body along.
+    uint16_t portion = (uint32_t(leg_phase) << 15) / stance;
+    shoulder = neutral_shoulder - stride / 2 + ScaleQ15(stride, portion);
+  } else {
+    // In the air: ease the shoulder back while the knee lifts and lowers.
+    uint16_t portion = (uint32_t(leg_phase - stance) << 15) /
+        (0x10000UL - stance);
+    shoulder = neutral_shoulder + stride - stride / 2 -
+        ScaleQ15(stride, EaseCosineQ15(portion));
+    uint16_t lift = portion < kQ15One / 2 ? EaseCosineQ15(portion * 2) :
+        EaseCosineQ15((kQ15One - portion) * 2);
+    // A leg without a stride stays planted, e.g. the inner legs of a pivot.
+    if (stride != 0)
+      knee -= ScaleQ15(kKneeLift, lift);
+  }
+
+  frame[kServoLeftFrontShoulder + leg] = shoulder;
+  frame[kServoLeftFrontKnee + leg] = knee;
+}
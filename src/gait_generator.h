@@ -0,0 +1,61 @@
+#ifndef _GAIT_GENERATOR_H
+#define _GAIT_GENERATOR_H
+
+#include <stdint.h>
+
+#include "skills.h"
+
+static const int kGaitLegs = 4;
+static const int kMaxGaitStride = 80;
+static const int kMaxGaitTurn = 64;
+
+// Central pattern generator for walking gaits. A fixed-point phase
+// oscillator drives all four legs, each with its own phase offset. During
+// the stance part of a leg's cycle (the duty factor) the shoulder sweeps
+// linearly through the stride; during swing it eases back while the knee
+// lifts. Frames come out in ServoIndex order like any skill frame.
+class GaitGenerator {
+ public:
+  GaitGenerator() {}
+
+  // Restarts the cycle at phase 0.
+  void Reset();
+  // Writes the frame for the current phase, then advances one step.
+  void Next(int8_t* frame);
+  // Writes the frame for the given phase, a fraction of the cycle in Q16.
+  void ComputeFrame(uint16_t phase, int8_t* frame) const;
+
+  // Shoulder sweep in degrees; negative strides walk backwards.
+  void set_stride(int stride);
+  int stride() const { return stride_; }
+  // Positive turns right by shortening the right legs' stride, negative
+  // turns left. kMaxGaitTurn stops the inner legs entirely.
+  void set_turn(int turn);
+  int turn() const { return turn_; }
+  // Portion of the cycle each leg spends on the ground, in Q8.
+  void set_duty_factor(uint8_t duty_factor) { duty_factor_ = duty_factor; }
+  uint8_t duty_factor() const { return duty_factor_; }
+  // Keyframes generated per cycle.
+  void set_frames_per_cycle(uint8_t frames);
+  uint8_t frames_per_cycle() const { return frames_per_cycle_; }
+  // Writes the kStableFramesPerSkill steps whose legs are closest to their
+  // neutral pose, picked like the stable frames of stored gaits.
+  void StableSteps(uint8_t* steps) const;
+  // Number of the keyframe that Next will write, and its phase.
+  void set_step(uint8_t step);
+  uint8_t step() const { return step_; }
+  uint16_t phase() const { return phase_; }
+
+ private:
+  void ComputeLeg(int leg, uint16_t phase, int stride, int8_t* frame) const;
+
+  uint16_t phase_ = 0;
+  uint8_t step_ = 0;
+  uint8_t frames_per_cycle_ = 24;
+  int8_t stride_ = 30;
+  int8_t turn_ = 0;
+  // Three legs on the ground at all times, close to the 72% of wkF.
+  uint8_t duty_factor_ = 192;
+};
+
+#endif  // _GAIT_GENERATOR_H
@@ -0,0 +1,148 @@
+#include "gait_generator.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <gtest/gtest.h>
+
+static const int kShoulders[kGaitLegs] = {
+  kServoLeftFrontShoulder, kServoRightFrontShoulder,
+  kServoRightBackShoulder, kServoLeftBackShoulder,
+};
+static const int kKnees[kGaitLegs] = {
+  kServoLeftFrontKnee, kServoRightFrontKnee,
+  kServoRightBackKnee, kServoLeftBackKnee,
+};
+
+// Returns the range a servo covers over one cycle.
+static int Excursion(const GaitGenerator& gait, int servo) {
+  int low = 127, high = -128;
+  for (uint32_t phase = 0; phase < 0x10000; phase += 0x100) {
+    int8_t frame[kServoCount];
+    gait.ComputeFrame(phase, frame);
+    if (frame[servo] < low) low = frame[servo];
+    if (frame[servo] > high) high = frame[servo];
+  }
+  return high - low;
+}
+
+TEST(GaitGeneratorTest, ZeroStrideStandsStill) {
+  GaitGenerator gait;
+  gait.set_stride(0);
+  int8_t first[kServoCount];
+  gait.ComputeFrame(0, first);
+  for (int i = kServoHead; i <= kServoTail; ++i)
+    EXPECT_EQ(0, first[i]);
+  for (int leg = 0; leg < kGaitLegs; ++leg) {
+    EXPECT_EQ(0, Excursion(gait, kShoulders[leg])) << "leg " << leg;
+    EXPECT_EQ(0, Excursion(gait, kKnees[leg])) << "leg " << leg;
+  }
+}
+
+TEST(GaitGeneratorTest, StrideSetsShoulderExcursion) {
+  GaitGenerator gait;
+  gait.set_stride(40);
+  for (int leg = 0; leg < kGaitLegs; ++leg) {
+    EXPECT_NEAR(40, Excursion(gait, kShoulders[leg]), 1) << "leg " << leg;
+    EXPECT_NEAR(20, Excursion(gait, kKnees[leg]), 1) << "leg " << leg;
+  }
+  gait.set_stride(1000);
+  EXPECT_EQ(kMaxGaitStride, gait.stride());
+  gait.set_stride(-1000);
+  EXPECT_EQ(-kMaxGaitStride, gait.stride());
+}
+
+TEST(GaitGeneratorTest, TurnShortensInnerStride) {
+  GaitGenerator gait;
+  gait.set_stride(40);
+  gait.set_turn(kMaxGaitTurn / 2);
+  EXPECT_NEAR(40, Excursion(gait, kServoLeftFrontShoulder), 1);
+  EXPECT_NEAR(40, Excursion(gait, kServoLeftBackShoulder), 1);
+  EXPECT_NEAR(20, Excursion(gait, kServoRightFrontShoulder), 1);
+  EXPECT_NEAR(20, Excursion(gait, kServoRightBackShoulder), 1);
+
+  gait.set_turn(-1000);
+  EXPECT_EQ(-kMaxGaitTurn, gait.turn());
+  EXPECT_EQ(0, Excursion(gait, kServoLeftFrontShoulder));
+  EXPECT_EQ(0, Excursion(gait, kServoLeftFrontKnee));
+  EXPECT_NEAR(40, Excursion(gait, kServoRightFrontShoulder), 1);
+}
+
+TEST(GaitGeneratorTest, KneesLiftOnlyDuringSwing) {
+  GaitGenerator gait;
+  int8_t neutral[kServoCount];
+  gait.set_stride(0);
+  gait.ComputeFrame(0, neutral);
+  gait.set_stride(30);
+
+  // At most one leg is in the air at a time in a walk, and the body always
+  // rests on at least three.
+  for (uint32_t phase = 0; phase < 0x10000; phase += 0x100) {
+    int8_t frame[kServoCount];
+    gait.ComputeFrame(phase, frame);
+    int lifted = 0;
+    for (int leg = 0; leg < kGaitLegs; ++leg) {
+      if (frame[kKnees[leg]] != neutral[kKnees[leg]])
+        ++lifted;
+    }
+    EXPECT_LE(lifted, 1) << "phase " << phase;
+  }
+}
+
+TEST(GaitGeneratorTest, NextStepsThroughTheCycle) {
+  GaitGenerator gait;
+  gait.set_frames_per_cycle(20);
+  int8_t frame[kServoCount];
+  int8_t expected[kServoCount];
+  for (int i = 0; i < 45; ++i) {
+    EXPECT_EQ(i % 20, gait.step());
+    gait.ComputeFrame(gait.phase(), expected);
+    gait.Next(frame);
+    EXPECT_EQ(0, memcmp(expected, frame, sizeof(frame)));
+  }
+  // Changing the pace keeps the place in the cycle.
+  gait.set_frames_per_cycle(40);
+  EXPECT_EQ(10, gait.step());
+  gait.Reset();
+  EXPECT_EQ(0, gait.step());
+  EXPECT_EQ(0, gait.phase());
+
+  gait.set_step(30);
+  EXPECT_EQ(30, gait.step());
+  EXPECT_EQ((30u << 16) / 40, gait.phase());
+  // Steps past the cycle start it over.
+  gait.set_step(40);
+  EXPECT_EQ(0, gait.step());
+}
+
+TEST(GaitGeneratorTest, StableStepsAreAQuarterCycleApart) {
+  GaitGenerator gait;
+  for (int frames : { 8, 24, 40 }) {
+    gait.set_frames_per_cycle(frames);
+    uint8_t steps[kStableFramesPerSkill];
+    gait.StableSteps(steps);
+    ASSERT_LT(steps[0], frames);
+    ASSERT_LT(steps[1], frames);
+    int apart = abs(steps[0] - steps[1]);
+    EXPECT_GE(std::min(apart, frames - apart), frames / 4) << frames;
+  }
+}
+
+TEST(GaitGeneratorTest, StanceSweepsForwardSwingReturns) {
+  GaitGenerator gait;
+  gait.set_stride(40);
+  gait.set_frames_per_cycle(50);
+  // Within stance the left back shoulder, whose cycle starts at phase 1/2,
+  // only increases; within swing it only decreases.
+  int8_t last[kServoCount];
+  gait.ComputeFrame(0x8000, last);
+  uint32_t stance_end = 0x8000 + (uint32_t(gait.duty_factor()) << 8);
+  for (uint32_t phase = 0x8100; phase < 0x18000; phase += 0x100) {
+    int8_t frame[kServoCount];
+    gait.ComputeFrame(phase, frame);
+    if (phase <= stance_end)
+      EXPECT_GE(frame[kServoLeftBackShoulder], last[kServoLeftBackShoulder]);
+    else
+      EXPECT_LE(frame[kServoLeftBackShoulder], last[kServoLeftBackShoulder]);
+    memcpy(last, frame, sizeof(last));
+  }
+}
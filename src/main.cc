@@ -10,10 +10,13 @@
 static const int kMpuI2CAddr = 0x68;
 static const float kDt = 10;
 static const float kTau = 500;
+// 200Hz samples, two or so per kDt poll.
+static const uint8_t kMpuRateDivider = 4;
 
 static EepromSettingsManager s_eeprom_settings;
 static ServoAnimator s_servo_animator;
 #ifdef MPU
+static TwiBus s_twi;
 static MPU6050 s_mpu(kMpuI2CAddr, kTau / 1000, kDt / 1000);
 #endif  // MPU
 static RemoteControl s_control(A0);
@@ -66,7 +69,40 @@ static void UpdateWalkingAnimation(int walk_mode, const int walk_modes[][3], int
   }
 }
 
+// While the generated gait plays, +/- change its speed and prev/next steer
+// it, all without stopping. Returns false for keys it does not handle.
+static bool HandleGaitKey(RemoteKey key) {
+  const int kStrideStep = 5;
+  const int kTurnStep = kMaxGaitTurn / 4;
+  GaitGenerator* gait = s_servo_animator.gait();
+  switch (key) {
+    case kKeyPlus:
+      gait->set_stride(gait->stride() + kStrideStep);
+      break;
+    case kKeyMinus:
+      gait->set_stride(gait->stride() - kStrideStep);
+      break;
+    case kKeyPrev:
+      gait->set_turn(gait->turn() - kTurnStep);
+      break;
+    case kKeyNext:
+      gait->set_turn(gait->turn() + kTurnStep);
+      break;
+    default:
+      return false;
+  }
+  Serial.print(F("Gait stride "));
+  Serial.print(gait->stride());
+  Serial.print(F(" turn "));
+  Serial.println(gait->turn());
+  return true;
+}
+
 static void HandleKey(RemoteKey key, int* ms_per_degree) {
+  if (s_servo_animator.animation_sequence() == kAnimationGait &&
+      HandleGaitKey(key))
+    return;
+
   int walk_mode = 0;
   const int walk_modes[][3] = {
     { kAnimationWalkLeft, kAnimationWalk, kAnimationWalkRight },
@@ -78,9 +114,11 @@ static void HandleKey(RemoteKey key, int* ms_per_degree) {
   int next_animation = kAnimationSingleFrame;
   switch (key) {
     case kKeyPause: {
-      next_animation = kAnimationRest;
+      int pose = kAnimationRest;
       if (s_servo_animator.animation_sequence() == kAnimationRest)
-        next_animation = kAnimationBalance;
+        pose = kAnimationBalance;
+      // A gait first walks on to where its feet are under the body.
+      s_servo_animator.StopAtStableFrame(pose, millis());
       break;
     }
     case kKeyPrev:
@@ -95,6 +133,9 @@ static void HandleKey(RemoteKey key, int* ms_per_degree) {
         walk_mode = 0;
       UpdateWalkingAnimation(walk_mode, walk_modes, walk_modes_max, &next_animation);
       break;
+    case kKeyCh:
+      next_animation = kAnimationGait;
+      break;
     case kKeyEq:
       next_animation = kAnimationStretch;
       break;
@@ -117,7 +158,14 @@ static void HandleKey(RemoteKey key, int* ms_per_degree) {
       next_animation = kAnimationSit;
       break;
     case kKey6:
-      next_animation = kAnimationFistBump;
+      if (s_servo_animator.animation_sequence() == kAnimationFistBump) {
+        next_animation = kAnimationFistBump;
+        break;
+      }
+      // A few bumps, then back to standing.
+      s_servo_animator.ClearQueue();
+      s_servo_animator.QueueAnimation(kAnimationFistBump, 3, 0);
+      s_servo_animator.QueueAnimation(kAnimationBalance, 1, 0);
       break;
     case kKey7:
       next_animation = kAnimationBackUpLeft;
@@ -153,6 +201,29 @@ static void HandleKey(RemoteKey key, int* ms_per_degree) {
   }
 }
 
+// Serial commands: 's' prints the emitted and suppressed writes of each
+// servo, 'r' resets them.
+static void HandleSerialCommand() {
+  if (!Serial.available())
+    return;
+  switch (Serial.read()) {
+    case 's':
+      for (int i = 0; i < kServoCount; ++i) {
+        Serial.print(i);
+        Serial.print(F(": "));
+        Serial.print(s_servo_animator.emitted_writes(i));
+        Serial.print(F(" emitted, "));
+        Serial.print(s_servo_animator.suppressed_writes(i));
+        Serial.println(F(" suppressed"));
+      }
+      break;
+    case 'r':
+      s_servo_animator.ResetWriteStats();
+      Serial.println(F("Write stats reset"));
+      break;
+  }
+}
+
 int main() {
   init();
 
@@ -163,7 +234,9 @@ int main() {
   s_servo_animator.Initialize();
   s_servo_animator.SetEepromSettings(&s_eeprom_settings.settings());
 #ifdef MPU
-  s_mpu.Initialize();
+  s_twi.Begin();
+  s_mpu.Initialize(&s_twi);
+  s_mpu.EnableFifo(kMpuRateDivider);
   s_mpu.SetGyroCorrection(s_eeprom_settings.settings().gyro_correction);
   s_mpu.SetPitchRollCorrection(s_eeprom_settings.settings().pitch_correction,
                                s_eeprom_settings.settings().roll_correction);
@@ -182,6 +255,11 @@ int main() {
   const int auto_mode_reenter_timeout = 10000;
   int manual_mode_ms_per_degree = 4;
   s_servo_animator.set_ms_per_degree(manual_mode_ms_per_degree);
+  // Keep gaits at their stride frequency when MPU reads or IR decoding delay
+  // the loop.
+  s_servo_animator.set_cadence_locked(true);
+  // Gait changes from the remote pick up the new gait where the legs are.
+  s_servo_animator.set_switch_mode(kSwitchNearestPose);
 
   s_auto.SetEnabled(true);
 
@@ -189,6 +267,8 @@ int main() {
     RemoteKey key;
     unsigned long millis_now = millis();
 
+    HandleSerialCommand();
+
     if (s_control_observer.Get(&key)) {
       if (first_key) {
         // First key press is our first entropy event. Use it.
@@ -227,16 +307,18 @@ void yield() {
   s_control.ReadAndDispatch(&s_control_observer);
 
 #ifdef MPU
+  // Reads run from the TWI interrupt while the loop goes on. Each poll
+  // brings the samples taken since the last one, filtered at the MPU6050's
+  // own rate.
   static long millis_last_mpu = 0;
-  if (millis_now - millis_last_mpu >= kDt) {
-    millis_last_mpu = millis_now;
-    int16_t accel[3];
-    int16_t gyro[3];
-    s_mpu.ReadBoth(accel, gyro);
-    float pitch, roll;
-    s_mpu.ComputeFilteredPitchRoll(accel, gyro, &pitch, &roll);
-    s_servo_animator.HandlePitchRoll(pitch, roll, millis_now);
+  int32_t pitch, roll;
+  if (s_mpu.ConsumeFifo(&pitch, &roll) > 0) {
+    // Q16 degrees to 1 / kAngleOne degrees.
+    s_servo_animator.HandlePitchRoll((pitch + 0x800) >> 12,
+                                     (roll + 0x800) >> 12, millis_now);
   }
+  if (millis_now - millis_last_mpu >= kDt && s_mpu.StartFifoRead())
+    millis_last_mpu = millis_now;
 #endif
 
   if (serialEventRun) {
@@ -4,84 +4,307 @@
 #include <stdlib.h>
 #include <string.h>
 
-#ifndef TESTING
-#include <Arduino.h>
-#include <Wire.h>
-#else
+#ifdef TESTING
 #include <stdio.h>
 #endif  // TESTING
 
 static const int PWR_MGMT_1 = 0x6B;
-static const int ACCEL_XOUT_H = 0x3B;
+static const uint8_t ACCEL_XOUT_H = 0x3B;
+
+static const int SMPLRT_DIV = 0x19;
+static const int CONFIG = 0x1A;
+static const int DLPF_CFG_44HZ = 3;
+static const int FIFO_EN = 0x23;
+static const int ACCEL_GYRO_FIFO_EN = 0x78;
+static const uint8_t USER_CTRL = 0x6A;
+static const uint8_t USER_FIFO_EN = 0x40;
+static const uint8_t FIFO_RESET = 0x04;
+static const uint8_t FIFO_COUNT_H = 0x72;
+static const uint8_t FIFO_R_W = 0x74;
+static const uint16_t kFifoBytes = 1024;
+// The gyro's output rate with the low pass filter on.
+static const float kFilteredRateHz = 1000;
+
+// Integral gain of the Mahony filter, per second per radian of error.
+static const float kMahonyKi = .1;
+// Most gyro bias the Mahony filter learns, in degrees/s: the MPU6050's zero
+// rate output tolerance. Error the filter can not explain with a real bias
+// stops there rather than winding up.
+static const float kMahonyMaxBiasDps = 20;
 
 static const int GYRO_CONFIG = 0x1B;
 static const int FS_SEL_500 = 1;
-static const float kGyroscopeSensitivity = 65.536;  // Full range is +/- 500 degrees/s
 
 static const int ACCEL_CONFIG = 0x1C;
 static const int AFS_SEL_4G = 1;
 static const int kAccelerometerSensitivity = 8192;  // Full range is +/- 4G
 
-void MPU6050::Initialize() {
-#ifndef TESTING
-  Wire.begin();
-  Wire.beginTransmission(addr_);
-  Wire.write(PWR_MGMT_1);
-  Wire.write(0);  // Wake up
-  Wire.endTransmission(true);
-
-  Wire.beginTransmission(addr_);
-  Wire.write(GYRO_CONFIG);
-  Wire.write(FS_SEL_500 << 3);
-  Wire.endTransmission(true);
-
-  Wire.beginTransmission(addr_);
-  Wire.write(ACCEL_CONFIG);
-  Wire.write(AFS_SEL_4G << 3);
-  Wire.endTransmission(true);
-
-#if 0
-  delay(100);
-
-  Wire.beginTransmission(addr_);
-  Wire.write(0x1b);
-  Wire.endTransmission(true);
-  Wire.requestFrom(addr_, 2, true);
-  Serial.print(F("gyro_config:  ")); Serial.println(Wire.read());
-  Serial.print(F("accel_config: ")); Serial.println(Wire.read());
-  delay(3000);
-#endif
-#endif  // TESTING
+void MPU6050::SetSampling(float sampling) {
+  sampling_ = sampling;
+  alpha_ = tau_ / (tau_ + sampling);
+  accel_weight_q15_ = uint16_t(sampling / (tau_ + sampling) * 32768 + .5f);
+  gyro_scale_q8_ = int32_t(sampling * 65536 * 256 / kGyroscopeSensitivity +
+                           .5f);
+  // Half angles, as the quaternion's derivative takes them. The
+  // accelerometer pulls with a gain of 1 / tau, so that errors settle as
+  // they do in the complementary filter.
+  mahony_gyro_scale_q30_ = int32_t(sampling / 2 * float(M_PI) / 180 /
+                                   kGyroscopeSensitivity * 1073741824.f + .5f);
+  mahony_kp_scale_q16_ = int32_t(sampling / 2 / tau_ * 65536 + .5f);
+  mahony_ki_scale_q24_ = int32_t(kMahonyKi * sampling * sampling / 2 *
+                                 16777216 + .5f);
+  // Capped so that one more integral step can not overflow.
+  float max_bias_q38 = kMahonyMaxBiasDps * sampling / 2 * float(M_PI) / 180 *
+      274877906944.f;
+  mahony_max_bias_q38_ = max_bias_q38 < 1073741824.f ?
+      int32_t(max_bias_q38 + .5f) : int32_t(1) << 30;
+}
+
+void MPU6050::Initialize(TwiBus* bus) {
+  bus_ = bus;
+  WriteRegister(PWR_MGMT_1, 0);  // Wake up
+  WriteRegister(GYRO_CONFIG, FS_SEL_500 << 3);
+  WriteRegister(ACCEL_CONFIG, AFS_SEL_4G << 3);
+}
+
+void MPU6050::WriteRegister(uint8_t reg, uint8_t value) {
+  const uint8_t data[] = { reg, value };
+  TwiTransaction write = {
+    uint8_t(addr_), data, sizeof(data), nullptr, 0, nullptr, kTwiIdle
+  };
+  bus_->Run(&write);
 }
 
 void MPU6050::SetGyroCorrection(const int* gyro_corrections) {
   memcpy(gyro_corrections_, gyro_corrections, sizeof(gyro_corrections_));
 }
 
-void MPU6050::ReadBoth(int16_t* accel, int16_t* gyro) {
-#ifndef TESTING
-  Wire.beginTransmission(addr_);
-  Wire.write(ACCEL_XOUT_H);
-  Wire.endTransmission(false);
-  Wire.requestFrom(addr_, 14, true);
-  for (int i = 0; i < 3; ++i)
-    accel[i] = (Wire.read() << 8) | Wire.read();
-  Wire.read();  // Throw out temperature reading
-  Wire.read();
-  for (int i = 0; i < 3; ++i)
-    gyro[i] = (Wire.read() << 8) | Wire.read();
-#if 0
+void MPU6050::SetUpRead(const uint8_t* write_data, uint8_t write_length,
+                        uint8_t read_length) {
+  read_.address = addr_;
+  read_.write_data = write_data;
+  read_.write_length = write_length;
+  read_.read_data = buffer_;
+  read_.read_length = read_length;
+}
+
+bool MPU6050::StartRead() {
+  SetUpRead(&ACCEL_XOUT_H, 1, 14);
+  return bus_->Queue(&read_);
+}
+
+bool MPU6050::ConsumeSample(int16_t* accel, int16_t* gyro) {
+  if (read_.status == kTwiQueued)
+    bus_->CheckTimeout();
+  if (!read_.finished())
+    return false;
+  bool ok = read_.status == kTwiDone;
+  read_.status = kTwiIdle;
+  if (!ok)
+    return false;
   for (int i = 0; i < 3; ++i) {
-    Serial.print(accel[i]);
-    Serial.print("\t");
+    accel[i] = int16_t((buffer_[2 * i] << 8) | buffer_[2 * i + 1]);
+    // Skips the temperature.
+    gyro[i] = int16_t((buffer_[2 * i + 8] << 8) | buffer_[2 * i + 9]);
+  }
+  return true;
+}
+
+void MPU6050::ReadBoth(int16_t* accel, int16_t* gyro) {
+  while (!StartRead())
+    bus_->CheckTimeout();
+  while (!read_.finished())
+    bus_->CheckTimeout();
+  ConsumeSample(accel, gyro);
+}
+
+void MPU6050::EnableFifo(uint8_t rate_divider) {
+  WriteRegister(CONFIG, DLPF_CFG_44HZ);
+  WriteRegister(SMPLRT_DIV, rate_divider);
+  WriteRegister(FIFO_EN, ACCEL_GYRO_FIFO_EN);
+  WriteRegister(USER_CTRL, USER_FIFO_EN | FIFO_RESET);
+  fifo_phase_ = kFifoIdle;
+  fifo_pending_ = 0;
+  SetSampling((1 + rate_divider) / kFilteredRateHz);
+}
+
+bool MPU6050::StartFifoRead() {
+  if (fifo_phase_ != kFifoIdle)
+    return false;
+  SetUpRead(&FIFO_COUNT_H, 1, 2);
+  if (!bus_->Queue(&read_))
+    return false;
+  fifo_phase_ = kFifoCount;
+  return true;
+}
+
+void MPU6050::QueueFifoData() {
+  uint8_t samples = fifo_pending_;
+  if (samples > kFifoBatch)
+    samples = kFifoBatch;
+  SetUpRead(&FIFO_R_W, 1, samples * kFifoSampleBytes);
+  fifo_phase_ = bus_->Queue(&read_) ? kFifoData : kFifoIdle;
+}
+
+int MPU6050::ConsumeFifo(int32_t* pitch, int32_t* roll) {
+  if (read_.status == kTwiQueued)
+    bus_->CheckTimeout();
+  if (fifo_phase_ == kFifoIdle || !read_.finished())
+    return 0;
+  uint8_t phase = fifo_phase_;
+  fifo_phase_ = kFifoIdle;
+  if (read_.status != kTwiDone) {
+    fifo_pending_ = 0;
+    return 0;
+  }
+
+  if (phase == kFifoCount) {
+    uint16_t count = (uint16_t(buffer_[0]) << 8) | buffer_[1];
+    // Once full the FIFO drops bytes, and with them the sample boundaries.
+    if (count > kFifoBytes - kFifoSampleBytes || count % kFifoSampleBytes) {
+      static const uint8_t kReset[] = {
+        USER_CTRL, USER_FIFO_EN | FIFO_RESET
+      };
+      SetUpRead(kReset, sizeof(kReset), 0);
+      fifo_pending_ = 0;
+      if (bus_->Queue(&read_))
+        fifo_phase_ = kFifoReset;
+      return 0;
+    }
+    fifo_pending_ = count / kFifoSampleBytes;
+    if (fifo_pending_ > 0)
+      QueueFifoData();
+    return 0;
   }
+  if (phase != kFifoData)
+    return 0;
+
+  uint8_t samples = read_.read_length / kFifoSampleBytes;
+  for (uint8_t sample = 0; sample < samples; ++sample) {
+    const uint8_t* data = buffer_ + sample * kFifoSampleBytes;
+    int16_t accel[3];
+    int16_t gyro[3];
+    for (int i = 0; i < 3; ++i) {
+      accel[i] = int16_t((data[2 * i] << 8) | data[2 * i + 1]);
+      gyro[i] = int16_t((data[2 * i + 6] << 8) | data[2 * i + 7]);
+    }
+    if (attitude_filter_ == kMahonyFilter)
+      ComputeMahonyPitchRollQ16(accel, gyro, pitch, roll);
+    else
+      ComputeFilteredPitchRollQ16(accel, gyro, pitch, roll);
+  }
+  fifo_pending_ -= samples;
+  if (fifo_pending_ > 0)
+    QueueFifoData();
+  return samples;
+}
+
+// The body's up, and the heading of its head, turned back into the body's
+// frame, with the quaternion's products in Q28.
+void QuaternionToPitchRollYawQ16(const int16_t* quaternion, int32_t* pitch,
+                                 int32_t* roll, int32_t* yaw) {
+  int32_t w = quaternion[0];
+  int32_t x = quaternion[1];
+  int32_t y = quaternion[2];
+  int32_t z = quaternion[3];
+  int16_t up_x = (x * z - w * y) >> 13;
+  int16_t up_y = (y * z + w * x) >> 13;
+  int16_t up_z = (w * w - x * x - y * y + z * z) >> 14;
+  *pitch = Atan2Q16(up_x, up_z);
+  *roll = Atan2Q16(up_y, up_z);
+  int16_t heading_x = (w * w + x * x - y * y - z * z) >> 14;
+  int16_t heading_y = (w * z + x * y) >> 13;
+  *yaw = Atan2Q16(heading_y, heading_x);
+}
+
+static int32_t MulQ30(int32_t a, int32_t b) {
+  return (int64_t(a) * b) >> 30;
+}
+
+static uint16_t SquareRoot(uint32_t value) {
+  uint32_t root = 0;
+  for (uint32_t bit = uint32_t(1) << 30; bit; bit >>= 2) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+  }
+  return root;
+}
+
+// The cross product of the measured and the estimated up is the turn that
+// would line them up. The gyro turns the quaternion by half angles, after
+// the correction and bias are added, and one Newton step keeps it unit.
+void MPU6050::ComputeMahonyPitchRollQ16(const int16_t* accel,
+                                        const int16_t* gyro,
+                                        int32_t* pitch, int32_t* roll) {
+  int32_t* q = quaternion_q30_;
+  int32_t half_angle[3];
   for (int i = 0; i < 3; ++i) {
-    Serial.print(gyro[i]);
-    Serial.print("\t");
+    half_angle[i] = (int32_t(gyro[i]) + gyro_corrections_[i]) *
+        mahony_gyro_scale_q30_ + (bias_q38_[i] >> 8);
   }
-  Serial.println();
-#endif
-#endif  // TESTING
+
+  uint32_t squares = 0;
+  for (int i = 0; i < 3; ++i)
+    squares += uint32_t(int32_t(accel[i]) * accel[i]);
+  uint16_t norm = SquareRoot(squares);
+  if (norm > 0) {
+    int32_t w = q[0] >> 16;
+    int32_t x = q[1] >> 16;
+    int32_t y = q[2] >> 16;
+    int32_t z = q[3] >> 16;
+    int32_t up[3] = {
+      (x * z - w * y) >> 13,
+      (y * z + w * x) >> 13,
+      (w * w - x * x - y * y + z * z) >> 14
+    };
+    int32_t inverse = (int32_t(1) << 30) / norm;
+    int32_t measured[3];
+    for (int i = 0; i < 3; ++i)
+      measured[i] = (accel[i] * inverse) >> 16;
+    int32_t error[3] = {
+      (measured[1] * up[2] - measured[2] * up[1]) >> 14,
+      (measured[2] * up[0] - measured[0] * up[2]) >> 14,
+      (measured[0] * up[1] - measured[1] * up[0]) >> 14
+    };
+    for (int i = 0; i < 3; ++i) {
+      bias_q38_[i] += error[i] * mahony_ki_scale_q24_;
+      if (bias_q38_[i] > mahony_max_bias_q38_)
+        bias_q38_[i] = mahony_max_bias_q38_;
+      if (bias_q38_[i] < -mahony_max_bias_q38_)
+        bias_q38_[i] = -mahony_max_bias_q38_;
+      half_angle[i] += error[i] * mahony_kp_scale_q16_;
+    }
+  }
+
+  int32_t w = q[0], x = q[1], y = q[2], z = q[3];
+  q[0] -= MulQ30(x, half_angle[0]) + MulQ30(y, half_angle[1]) +
+      MulQ30(z, half_angle[2]);
+  q[1] += MulQ30(w, half_angle[0]) + MulQ30(y, half_angle[2]) -
+      MulQ30(z, half_angle[1]);
+  q[2] += MulQ30(w, half_angle[1]) - MulQ30(x, half_angle[2]) +
+      MulQ30(z, half_angle[0]);
+  q[3] += MulQ30(w, half_angle[2]) + MulQ30(x, half_angle[1]) -
+      MulQ30(y, half_angle[0]);
+
+  uint32_t length = 0;
+  for (int i = 0; i < 4; ++i) {
+    int32_t component = q[i] >> 15;
+    length += uint32_t(component * component);
+  }
+  int32_t scale = int32_t(((uint32_t(3) << 30) - length) >> 1);
+  int16_t quaternion[4];
+  for (int i = 0; i < 4; ++i) {
+    q[i] = MulQ30(q[i], scale);
+    quaternion[i] = q[i] >> 16;
+  }
+
+  QuaternionToPitchRollYawQ16(quaternion, pitch, roll, &yaw_q16_);
+  *pitch += pitch_correction_q16_;
+  *roll += roll_correction_q16_;
 }
 
 // Complementary filter implementation.
@@ -122,3 +345,52 @@ void MPU6050::ComputeFilteredPitchRoll(const int16_t* accel, const int16_t* gyro
   *roll = last_roll_ + roll_correction_;
 }
 
+// atan(r) for r in [0, 1] in Q15, as 45 r + r (1 - r) (14.02 + 3.80 r)
+// degrees, which is within .09 degrees. The last term is in Q12 degrees.
+static int32_t AtanQ16(uint16_t r) {
+  int32_t curve = (uint32_t(r) * (32768 - r)) >> 15;
+  int32_t poly = 57426 + ((uint32_t(15565) * r) >> 15);
+  return int32_t(r) * 90 + (((curve * poly) >> 15) << 4);
+}
+
+int32_t Atan2Q16(int16_t y, int16_t x) {
+  static const int32_t k90 = int32_t(90) << 16;
+  uint16_t ax = x < 0 ? -int32_t(x) : x;
+  uint16_t ay = y < 0 ? -int32_t(y) : y;
+  if (ax == 0 && ay == 0)
+    return 0;
+  int32_t angle;
+  if (ay <= ax)
+    angle = AtanQ16((uint32_t(ay) << 15) / ax);
+  else
+    angle = k90 - AtanQ16((uint32_t(ax) << 15) / ay);
+  if (x < 0)
+    angle = 2 * k90 - angle;
+  return y < 0 ? -angle : angle;
+}
+
+// Same filter as ComputeFilteredPitchRoll, without floats: the gyro step is
+// one multiply by the precomputed scale, and the accelerometer angles come
+// from Atan2Q16.
+void MPU6050::ComputeFilteredPitchRollQ16(const int16_t* accel,
+                                          const int16_t* gyro,
+                                          int32_t* pitch, int32_t* roll) {
+  int32_t corrected_gyro[2] = {
+    int32_t(gyro[0]) + gyro_corrections_[0],
+    int32_t(gyro[1]) + gyro_corrections_[1]
+  };
+  last_roll_q16_ += (corrected_gyro[0] * gyro_scale_q8_) >> 8;
+  last_pitch_q16_ -= (corrected_gyro[1] * gyro_scale_q8_) >> 8;
+
+  int32_t acceleration_pitch = Atan2Q16(accel[0], accel[2]);
+  int32_t acceleration_roll = Atan2Q16(accel[1], accel[2]);
+  // Moves by the accelerometer's weight towards its angle. The difference is
+  // taken in 1/256 degrees so that the product fits 32 bits.
+  last_pitch_q16_ += (((acceleration_pitch - last_pitch_q16_) >> 8) *
+                      accel_weight_q15_) >> 7;
+  last_roll_q16_ += (((acceleration_roll - last_roll_q16_) >> 8) *
+                     accel_weight_q15_) >> 7;
+
+  *pitch = last_pitch_q16_ + pitch_correction_q16_;
+  *roll = last_roll_q16_ + roll_correction_q16_;
+}
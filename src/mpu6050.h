@@ -3,35 +3,132 @@
 
 #include <stdint.h>
 
+#include "twi_bus.h"
+
 static const float kDefaultGyroWeight = .98;
+// LSB per degree/s at the +/- 500 degrees/s full range.
+static const float kGyroscopeSensitivity = 65.536;
+
+// atan2 of y and x in Q16 degrees, within .1 degree.
+int32_t Atan2Q16(int16_t y, int16_t x);
+
+// Pitch and roll in Q16 degrees, measured like ComputeFilteredPitchRoll, and
+// yaw, of a body turned by the unit quaternion w, x, y, z in Q14.
+void QuaternionToPitchRollYawQ16(const int16_t* quaternion, int32_t* pitch,
+                                 int32_t* roll, int32_t* yaw);
+
+// How ConsumeFifo turns accelerometer and gyro samples into angles.
+enum AttitudeFilter { kComplementaryFilter, kMahonyFilter };
 
 class MPU6050 {
  public:
   // addr is i2c addre sof MPU6050. tau is how quickly to make pitch/roll respond
   // to quick movements (more quickly means more potential for drift), and
   // sampling is the sampling rate at which you call ComputeFilteredPitchRoll.
- 	MPU6050(int addr, float tau, float sampling)
-      : addr_(addr), sampling_(sampling), alpha_(tau / (tau + sampling)) {}
-  void Initialize();
+ 	MPU6050(int addr, float tau, float sampling) : addr_(addr), tau_(tau) {
+    SetSampling(sampling);
+  }
+  // Wakes the MPU6050 on bus and sets its ranges, waiting for each write.
+  void Initialize(TwiBus* bus);
+  // Queues a read of the accelerometer and gyro. Returns false while the
+  // last read is still running or the bus queue is full.
+  bool StartRead();
+  // Returns true once for each finished read, with its sample in accel and
+  // gyro. Failed reads, and reads that time out on the bus, are dropped.
+  bool ConsumeSample(int16_t* accel, int16_t* gyro);
+  // StartRead and ConsumeSample, waiting for the read in between.
  	void ReadBoth(int16_t* accel, int16_t* gyro);
+
+  // Most accelerometer and gyro samples one FIFO read brings.
+  static const uint8_t kFifoBatch = 4;
+  // Bytes of one FIFO sample: accelerometer then gyro, without temperature.
+  static const uint8_t kFifoSampleBytes = 12;
+  // Has the MPU6050 sample at 1kHz / (1 + rate_divider) through its 44Hz low
+  // pass filter into its FIFO, and sets the filters' period to match.
+  // StartFifoRead and ConsumeFifo then replace StartRead and ConsumeSample.
+  void EnableFifo(uint8_t rate_divider);
+  // Queues a read of how much the FIFO holds. Returns false while the last
+  // FIFO read is still going.
+  bool StartFifoRead();
+  // Moves the FIFO read along. Once its samples land, runs each through the
+  // attitude filter and returns how many, with the last angles in pitch and
+  // roll. Samples left in the FIFO are read next, without asking for the
+  // count again, and an overflowed FIFO is reset.
+  int ConsumeFifo(int32_t* pitch, int32_t* roll);
+  // The yaw of the last Mahony filter step, in Q16 degrees.
+  int32_t yaw_q16() const { return yaw_q16_; }
+  void set_attitude_filter(AttitudeFilter filter) { attitude_filter_ = filter; }
 	void ComputeFilteredPitchRoll(const int16_t* accel, const int16_t* gyro,
 				        								float* pitch, float* roll);
+  // ComputeFilteredPitchRoll in fixed point, with angles in Q16 degrees.
+  // Keeps its own state, and tracks the float filter within .5 degrees.
+  // Sampling periods up to .1s keep the gyro step within 32 bits.
+  void ComputeFilteredPitchRollQ16(const int16_t* accel, const int16_t* gyro,
+                                   int32_t* pitch, int32_t* roll);
+  // Mahony's quaternion filter in fixed point, in place of
+  // ComputeFilteredPitchRollQ16 with the same response time. Turning the
+  // whole attitude keeps pitch and roll right when the body turns while
+  // tilted, and an integral term learns the gyro's bias. Also updates
+  // yaw_q16, which comes from the gyro alone.
+  void ComputeMahonyPitchRollQ16(const int16_t* accel, const int16_t* gyro,
+                                 int32_t* pitch, int32_t* roll);
   void SetPitchRollCorrection(float pitch_correction, float roll_correction) {
     pitch_correction_ = pitch_correction;
     roll_correction_ = roll_correction;
+    pitch_correction_q16_ = int32_t(pitch_correction * 65536);
+    roll_correction_q16_ = int32_t(roll_correction * 65536);
   }
   void SetGyroCorrection(const int* gyro_corrections);
 
 #ifndef TESTING
  private:
 #endif
+  enum FifoPhase { kFifoIdle, kFifoCount, kFifoData, kFifoReset };
+
+  void SetSampling(float sampling);
+  void WriteRegister(uint8_t reg, uint8_t value);
+  void SetUpRead(const uint8_t* write_data, uint8_t write_length,
+                 uint8_t read_length);
+  void QueueFifoData();
+
   int addr_;
+  float tau_;
+  TwiBus* bus_ = nullptr;
+  TwiTransaction read_ = {};
+  // Accelerometer, temperature and gyro, or the FIFO's count or samples,
+  // high bytes first.
+  uint8_t buffer_[kFifoBatch * kFifoSampleBytes];
+  uint8_t fifo_phase_ = kFifoIdle;
+  int32_t yaw_q16_ = 0;
+  uint8_t attitude_filter_ = kComplementaryFilter;
+  // Samples known to be in the FIFO and not read yet.
+  uint8_t fifo_pending_ = 0;
   float sampling_;
   float alpha_;
   float pitch_correction_ = 0;
   float roll_correction_ = 0;
   float last_pitch_ = 0;
   float last_roll_ = 0;
+  // State of the fixed point filter. The accelerometer's weight is 1 - alpha_
+  // in Q15, and the gyro scale turns a reading into Q16 degrees per sample
+  // in Q8.
+  uint16_t accel_weight_q15_;
+  int32_t gyro_scale_q8_;
+  int32_t pitch_correction_q16_ = 0;
+  int32_t roll_correction_q16_ = 0;
+  int32_t last_pitch_q16_ = 0;
+  int32_t last_roll_q16_ = 0;
+  // State of the Mahony filter: the attitude as a Q30 quaternion, and the
+  // gyro bias it has learned in Q38 half radians per sample, up to
+  // mahony_max_bias_q38_. The scales turn a gyro reading into Q30 half
+  // radians per sample, and a Q14 error into the proportional and integral
+  // corrections.
+  int32_t quaternion_q30_[4] = { int32_t(1) << 30, 0, 0, 0 };
+  int32_t bias_q38_[3] = {0};
+  int32_t mahony_gyro_scale_q30_;
+  int32_t mahony_kp_scale_q16_;
+  int32_t mahony_ki_scale_q24_;
+  int32_t mahony_max_bias_q38_;
   int gyro_corrections_[3] = {0};
 };
 
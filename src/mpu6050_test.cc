@@ -1,4 +1,10 @@
 #include "mpu6050.h"
+#include "twi_bus_testfake.h"
+
+#include <math.h>
+#include <chrono>
+#include <memory>
+#include <vector>
 #include <gtest/gtest.h>
 
 const float k1G = 1 << 14;
@@ -14,9 +20,23 @@ class MpuTest : public testing::Test {
     mpu_.reset(new MPU6050(0, kTau/1000, kDt / 1000));
   }
 
+  // Every scenario also runs the fixed point filter, which has to agree.
+  void TearDown() override {
+    EXPECT_LT(max_fixed_error_, .5);
+  }
+
+  void Step() {
+    mpu_->ComputeFilteredPitchRoll(accel_, gyro_, &pitch_, &roll_);
+    int32_t pitch;
+    int32_t roll;
+    mpu_->ComputeFilteredPitchRollQ16(accel_, gyro_, &pitch, &roll);
+    max_fixed_error_ = fmax(max_fixed_error_, fabs(pitch / 65536. - pitch_));
+    max_fixed_error_ = fmax(max_fixed_error_, fabs(roll / 65536. - roll_));
+  }
+
   void RunSameManyTimes() {
     for (int i = 0; i < kTau/kDt * 100; ++i) {
-      mpu_->ComputeFilteredPitchRoll(accel_, gyro_, &pitch_, &roll_);
+      Step();
       //printf("%d: %f, %f\n", i, pitch_, roll_);
     }
   }
@@ -26,6 +46,7 @@ class MpuTest : public testing::Test {
   int16_t gyro_[3] = {0, 0, 0};
   float roll_ = 0;
   float pitch_ = 0;
+  double max_fixed_error_ = 0;
 };
 
 TEST_F(MpuTest, Alpha) {
@@ -44,8 +65,8 @@ TEST_F(MpuTest, Alpha) {
 TEST_F(MpuTest, SingleCallFiltering) {
   const float kIntEpsilon = .5;
   accel_[0] = accel_[2] = k1G;
-  mpu_->ComputeFilteredPitchRoll(accel_, gyro_, &pitch_, &roll_);
-  mpu_->ComputeFilteredPitchRoll(accel_, gyro_, &pitch_, &roll_);
+  Step();
+  Step();
   // Gyro reading 0, history is 0, 0. So first call result only based
   // on alpha weighting portion of result coming from Gyros, which with
   // will be 45 degrees pitched.
@@ -55,7 +76,7 @@ TEST_F(MpuTest, SingleCallFiltering) {
   EXPECT_NEAR(expect_pitch, pitch_, kIntEpsilon);
 
   accel_[0] = 0;
-  mpu_->ComputeFilteredPitchRoll(accel_, gyro_, &pitch_, &roll_);
+  Step();
 
   expect_pitch = expect_pitch * .9803;
   EXPECT_NEAR(2, expect_pitch, kIntEpsilon);
@@ -65,7 +86,7 @@ TEST_F(MpuTest, SingleCallFiltering) {
   // Gyro is a 16b signed number where 32768 is 500/s of rotation.
   gyro_[0] = 19660;  // 300 degrees/s
   gyro_[1] = 26214;  // 400 degrees/s
-  mpu_->ComputeFilteredPitchRoll(accel_, gyro_, &pitch_, &roll_);
+  Step();
   // Because sampling rate is 1s, we assume we have rotated a full 30 degrees
   // on roll and 60 degrees on pitch, but this is affected by alpha.
   float expect_roll = 300 * .01 * .9802;
@@ -132,4 +153,550 @@ TEST_F(MpuTest, RollCorrections) {
   RunSameManyTimes();
   EXPECT_NEAR(0, pitch_, kEpsilon);
   EXPECT_NEAR(0, roll_, kEpsilon);
-}
\ No newline at end of file
+}
+
+TEST(Atan2Q16Test, MatchesAtan2) {
+  double max_error = 0;
+  for (int y = -32768; y < 32768; y += 97) {
+    for (int x = -32768; x < 32768; x += 89) {
+      double expected = atan2(y, x) * 180 / M_PI;
+      double error = fabs(Atan2Q16(y, x) / 65536. - expected);
+      // -180 and 180 are the same angle.
+      max_error = fmax(max_error, fmin(error, 360 - error));
+    }
+  }
+  printf("Atan2Q16 max error %.3f degrees\n", max_error);
+  EXPECT_LT(max_error, .1);
+  EXPECT_EQ(0, Atan2Q16(0, 0));
+  EXPECT_EQ(90 << 16, Atan2Q16(100, 0));
+  EXPECT_EQ(180 << 16, Atan2Q16(0, -100));
+}
+
+// A body rocking in pitch and roll, with noise and gyro bias as on the
+// robot.
+static void Trace(int i, int16_t* accel, int16_t* gyro) {
+  double t = i * kDt / 1000;
+  double pitch = 30 * sin(t * 1.3) * M_PI / 180;
+  double roll = 20 * sin(t * 2.1 + 1) * M_PI / 180;
+  double noise = ((i * 7919) % 200 - 100) * 20;
+  accel[0] = k1G * sin(pitch) + noise;
+  accel[1] = k1G * sin(roll) - noise;
+  accel[2] = k1G * cos(pitch) * cos(roll);
+  gyro[0] = 20 * 2.1 * cos(t * 2.1 + 1) * kGyroscopeSensitivity + 40;
+  gyro[1] = -30 * 1.3 * cos(t * 1.3) * kGyroscopeSensitivity - 25;
+  gyro[2] = 0;
+}
+
+TEST_F(MpuTest, FixedPointTracksFloatOnATrace) {
+  mpu_->SetPitchRollCorrection(2.5, -1.25);
+  int gyro_correction[3] = { -40, 25, 0 };
+  mpu_->SetGyroCorrection(gyro_correction);
+  for (int i = 0; i < 6000; ++i) {
+    Trace(i, accel_, gyro_);
+    Step();
+  }
+  printf("Fixed point filter max difference from float: %.3f degrees\n",
+         max_fixed_error_);
+}
+
+TEST_F(MpuTest, FilterBenchmark) {
+  const int kSamples = 1000;
+  const int kRuns = 200;
+  std::vector<int16_t> samples(kSamples * 6);
+  for (int i = 0; i < kSamples; ++i)
+    Trace(i, &samples[i * 6], &samples[i * 6 + 3]);
+
+  float pitch = 0;
+  float roll = 0;
+  int32_t pitch_q16 = 0;
+  int32_t roll_q16 = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < kRuns; ++run) {
+    for (int i = 0; i < kSamples; ++i) {
+      mpu_->ComputeFilteredPitchRoll(&samples[i * 6], &samples[i * 6 + 3],
+                                     &pitch, &roll);
+    }
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (int run = 0; run < kRuns; ++run) {
+    for (int i = 0; i < kSamples; ++i) {
+      mpu_->ComputeFilteredPitchRollQ16(&samples[i * 6], &samples[i * 6 + 3],
+                                        &pitch_q16, &roll_q16);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  double float_ns = std::chrono::duration<double, std::nano>(
+      middle - start).count() / (kRuns * kSamples);
+  double fixed_ns = std::chrono::duration<double, std::nano>(
+      end - middle).count() / (kRuns * kSamples);
+  // The host has a float unit, unlike the ATmega328p, so this understates
+  // the gap on the robot.
+  printf("Filter step on the host: float %.1fns, Q16 %.1fns "
+         "(last %.1f/%.1f and %.1f/%.1f degrees)\n", float_ns, fixed_ns,
+         pitch, pitch_q16 / 65536., roll, roll_q16 / 65536.);
+}
+
+TEST(MpuReadTest, StartPollConsume) {
+  TwiBus bus;
+  TwiDeviceFake device(0x68);
+  MPU6050 mpu(0x68, kTau / 1000, kDt / 1000);
+  mpu.bus_ = &bus;
+  const int16_t kAccel[3] = { 1000, -2, -16384 };
+  const int16_t kGyro[3] = { -300, 4, 32767 };
+  for (int i = 0; i < 3; ++i) {
+    device.registers_[0x3b + 2 * i] = uint16_t(kAccel[i]) >> 8;
+    device.registers_[0x3c + 2 * i] = kAccel[i] & 0xff;
+    device.registers_[0x43 + 2 * i] = uint16_t(kGyro[i]) >> 8;
+    device.registers_[0x44 + 2 * i] = kGyro[i] & 0xff;
+  }
+  device.registers_[0x41] = 0x55;
+
+  int16_t accel[3] = {};
+  int16_t gyro[3] = {};
+  EXPECT_FALSE(mpu.ConsumeSample(accel, gyro));
+  ASSERT_TRUE(mpu.StartRead());
+  // Until the bus is done there is nothing to consume, or to start.
+  EXPECT_FALSE(mpu.StartRead());
+  EXPECT_FALSE(mpu.ConsumeSample(accel, gyro));
+  device.Run(&bus);
+  ASSERT_TRUE(mpu.ConsumeSample(accel, gyro));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(kAccel[i], accel[i]) << i;
+    EXPECT_EQ(kGyro[i], gyro[i]) << i;
+  }
+  EXPECT_FALSE(mpu.ConsumeSample(accel, gyro));
+
+  // A failed read is dropped and the next one can start.
+  device.absent_ = true;
+  ASSERT_TRUE(mpu.StartRead());
+  device.Run(&bus);
+  EXPECT_FALSE(mpu.ConsumeSample(accel, gyro));
+  EXPECT_TRUE(mpu.StartRead());
+
+  // So is a read that never finishes.
+  EXPECT_FALSE(mpu.ConsumeSample(accel, gyro));
+  EXPECT_FALSE(mpu.StartRead());
+  bus.fake_millis_ += TwiBus::kTimeoutMs;
+  EXPECT_FALSE(mpu.ConsumeSample(accel, gyro));
+  EXPECT_TRUE(mpu.StartRead());
+}
+
+class MpuFifoTest : public testing::Test {
+ protected:
+  enum { kDivider = 4 };
+
+  MpuFifoTest() : device_(0x68), mpu_(0x68, kTau / 1000, kDt / 1000) {
+    device_.fifo_register_ = 0x74;
+    bus_.fake_wait_ = [this]() { device_.Run(&bus_); };
+    mpu_.Initialize(&bus_);
+    mpu_.EnableFifo(kDivider);
+  }
+
+  void Push(const int16_t* accel, const int16_t* gyro) {
+    for (const int16_t* values : { accel, gyro }) {
+      for (int i = 0; i < 3; ++i) {
+        device_.fifo_.push_back(uint16_t(values[i]) >> 8);
+        device_.fifo_.push_back(values[i] & 0xff);
+      }
+    }
+  }
+
+  // Polls the way yield() does until the FIFO read is over, and returns the
+  // samples it filtered.
+  int Poll(int32_t* pitch, int32_t* roll) {
+    EXPECT_TRUE(mpu_.StartFifoRead());
+    EXPECT_FALSE(mpu_.StartFifoRead());
+    int samples = 0;
+    for (int i = 0; i < 100 && mpu_.fifo_phase_ != MPU6050::kFifoIdle; ++i) {
+      device_.Run(&bus_);
+      samples += mpu_.ConsumeFifo(pitch, roll);
+    }
+    EXPECT_EQ(MPU6050::kFifoIdle, mpu_.fifo_phase_);
+    return samples;
+  }
+
+  TwiBus bus_;
+  TwiDeviceFake device_;
+  MPU6050 mpu_;
+};
+
+TEST_F(MpuFifoTest, EnableFifoSetsUpTheChip) {
+  EXPECT_EQ(0, device_.registers_[0x6b]);
+  EXPECT_EQ(0x08, device_.registers_[0x1b]);
+  EXPECT_EQ(0x08, device_.registers_[0x1c]);
+  EXPECT_EQ(3, device_.registers_[0x1a]);
+  EXPECT_EQ(int(kDivider), device_.registers_[0x19]);
+  EXPECT_EQ(0x78, device_.registers_[0x23]);
+  EXPECT_EQ(0x44, device_.registers_[0x6a]);
+  // The filters step by the chip's sample period.
+  EXPECT_FLOAT_EQ(.005, mpu_.sampling_);
+
+  int32_t pitch = 1;
+  int32_t roll = 1;
+  EXPECT_EQ(0, Poll(&pitch, &roll));
+  EXPECT_EQ(1, pitch);
+}
+
+TEST_F(MpuFifoTest, BatchesFilterEverySampleAtTheChipsRate) {
+  MPU6050 reference(0, kTau / 1000, .005);
+  int transactions = 0;
+  int total = 0;
+  int32_t expected_pitch = 0;
+  int32_t expected_roll = 0;
+  for (int poll = 0; poll < 40; ++poll) {
+    // From none to more than a batch between polls, as loop hiccups give.
+    int samples = poll % 7;
+    for (int sample = 0; sample < samples; ++sample) {
+      int step = total + sample;
+      int16_t accel[3] = {
+        int16_t(4000 * sin(step / 20.)), int16_t(-3000 * cos(step / 30.)),
+        int16_t(k1G * .9)
+      };
+      int16_t gyro[3] = {
+        int16_t(500 * cos(step / 10.)), int16_t(-700 * sin(step / 15.)), 12
+      };
+      Push(accel, gyro);
+      reference.ComputeFilteredPitchRollQ16(accel, gyro, &expected_pitch,
+                                            &expected_roll);
+    }
+    int before = device_.transactions_;
+    int32_t pitch = 0;
+    int32_t roll = 0;
+    ASSERT_EQ(samples, Poll(&pitch, &roll)) << "poll " << poll;
+    transactions += device_.transactions_ - before;
+    total += samples;
+    if (samples > 0) {
+      EXPECT_EQ(expected_pitch, pitch) << "poll " << poll;
+      EXPECT_EQ(expected_roll, roll) << "poll " << poll;
+    }
+    // A count, then one read per batch.
+    EXPECT_EQ(1 + (samples + MPU6050::kFifoBatch - 1) / MPU6050::kFifoBatch,
+              device_.transactions_ - before) << "poll " << poll;
+  }
+  printf("%d samples in %d bus transactions, against %d one at a time\n",
+         total, transactions, total);
+  EXPECT_LT(transactions, total);
+}
+
+TEST_F(MpuFifoTest, OverflowResetsTheFifo) {
+  const int16_t kAccel[3] = { 0, 0, int16_t(k1G) };
+  const int16_t kGyro[3] = { 0, 0, 0 };
+  for (int i = 0; i < 86; ++i)
+    Push(kAccel, kGyro);
+  device_.registers_[0x6a] = 0;
+  int32_t pitch = 0;
+  int32_t roll = 0;
+  EXPECT_EQ(0, Poll(&pitch, &roll));
+  EXPECT_EQ(0x44, device_.registers_[0x6a]);
+
+  // Samples after the reset come through.
+  device_.fifo_.clear();
+  Push(kAccel, kGyro);
+  EXPECT_EQ(1, Poll(&pitch, &roll));
+}
+
+// The quaternion in Q14.
+static void QuaternionQ14(const double* quaternion, int16_t* q14) {
+  for (int i = 0; i < 4; ++i)
+    q14[i] = int16_t(lround(quaternion[i] * (1 << 14)));
+}
+
+// The quaternion of a turn by yaw about z, then pitch about y, then roll
+// about x, in degrees.
+static void EulerQuaternion(double yaw, double pitch, double roll,
+                            double* quaternion) {
+  double cy = cos(yaw * M_PI / 360), sy = sin(yaw * M_PI / 360);
+  double cp = cos(pitch * M_PI / 360), sp = sin(pitch * M_PI / 360);
+  double cr = cos(roll * M_PI / 360), sr = sin(roll * M_PI / 360);
+  quaternion[0] = cr * cp * cy + sr * sp * sy;
+  quaternion[1] = sr * cp * cy - cr * sp * sy;
+  quaternion[2] = cr * sp * cy + sr * cp * sy;
+  quaternion[3] = cr * cp * sy - sr * sp * cy;
+}
+
+// What the accelerometer angles of ComputeFilteredPitchRoll give for a body
+// at rest in that orientation, and its yaw, in degrees.
+static void ExpectedAngles(const double* q, double* pitch, double* roll,
+                           double* yaw) {
+  double w = q[0], x = q[1], y = q[2], z = q[3];
+  double up_x = 2 * (x * z - w * y);
+  double up_y = 2 * (y * z + w * x);
+  double up_z = w * w - x * x - y * y + z * z;
+  *pitch = atan2(up_x, up_z) * 180 / M_PI;
+  *roll = atan2(up_y, up_z) * 180 / M_PI;
+  *yaw = atan2(2 * (w * z + x * y), w * w + x * x - y * y - z * z) * 180 /
+      M_PI;
+}
+
+TEST(QuaternionTest, SimpleTurns) {
+  // Level, a quarter turn left, and 20 degrees nose up.
+  const int16_t kQuaternions[][4] = {
+    { 0x4000, 0, 0, 0 },
+    { 0x2d41, 0, 0, 0x2d41 },
+    { 0x3f07, 0, -0x0b1e, 0 },
+  };
+  const double kExpected[][3] = { { 0, 0, 0 }, { 0, 0, 90 }, { 20, 0, 0 } };
+  for (int turn = 0; turn < 3; ++turn) {
+    int32_t pitch, roll, yaw;
+    QuaternionToPitchRollYawQ16(kQuaternions[turn], &pitch, &roll, &yaw);
+    EXPECT_NEAR(kExpected[turn][0], pitch / 65536., .1) << turn;
+    EXPECT_NEAR(kExpected[turn][1], roll / 65536., .1) << turn;
+    EXPECT_NEAR(kExpected[turn][2], yaw / 65536., .1) << turn;
+  }
+}
+
+TEST(QuaternionTest, MatchesFloatAngles) {
+  double max_error = 0;
+  for (int yaw = -180; yaw < 180; yaw += 15) {
+    for (int pitch = -80; pitch <= 80; pitch += 8) {
+      for (int roll = -80; roll <= 80; roll += 8) {
+        double q[4];
+        EulerQuaternion(yaw, pitch, roll, q);
+        int16_t quaternion[4];
+        QuaternionQ14(q, quaternion);
+        int32_t fixed[3];
+        QuaternionToPitchRollYawQ16(quaternion, &fixed[0], &fixed[1],
+                                    &fixed[2]);
+        double expected[3];
+        ExpectedAngles(q, &expected[0], &expected[1], &expected[2]);
+        for (int i = 0; i < 3; ++i) {
+          double error = fabs(fixed[i] / 65536. - expected[i]);
+          // Yaw wraps at 180 degrees.
+          error = fmin(error, 360 - error);
+          max_error = fmax(max_error, error);
+        }
+      }
+    }
+  }
+  printf("Quaternion angles max error %.3f degrees\n", max_error);
+  EXPECT_LT(max_error, .3);
+}
+
+static void MultiplyQuaternions(const double* a, const double* b,
+                                double* product) {
+  product[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  product[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  product[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  product[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+// A motion as yaw, pitch and roll in degrees over time in seconds.
+typedef void (*Motion)(double t, double* yaw, double* pitch, double* roll);
+
+struct AttitudeTrace {
+  std::vector<int16_t> samples;  // Accelerometer and gyro.
+  std::vector<double> angles;  // True pitch, roll and yaw after each sample.
+};
+
+// Uniform in -range to range.
+static double Noise(uint32_t* seed, int range) {
+  *seed = *seed * 1103515245 + 12345;
+  return int((*seed >> 8) % (2 * range + 1)) - range;
+}
+
+// Samples a motion at kDt the way the MPU6050 would, with noise and a gyro
+// bias the calibration missed.
+static AttitudeTrace RecordTrace(Motion motion, double seconds) {
+  AttitudeTrace trace;
+  uint32_t seed = 12345;
+  int count = seconds * 1000 / kDt;
+  double angles[3];
+  double last[4];
+  motion(0, &angles[0], &angles[1], &angles[2]);
+  EulerQuaternion(angles[0], angles[1], angles[2], last);
+  for (int i = 1; i <= count; ++i) {
+    double q[4];
+    motion(i * kDt / 1000, &angles[0], &angles[1], &angles[2]);
+    EulerQuaternion(angles[0], angles[1], angles[2], q);
+    // The body rates that turn last into q.
+    double inverse[4] = { last[0], -last[1], -last[2], -last[3] };
+    double turn[4];
+    MultiplyQuaternions(inverse, q, turn);
+    double sign = turn[0] < 0 ? -1 : 1;
+    double up[3] = {
+      2 * (q[1] * q[3] - q[0] * q[2]),
+      2 * (q[2] * q[3] + q[0] * q[1]),
+      q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]
+    };
+    for (int axis = 0; axis < 3; ++axis)
+      trace.samples.push_back(lround(k1G * up[axis] + Noise(&seed, 2000)));
+    for (int axis = 0; axis < 3; ++axis) {
+      double degrees_per_s = sign * 2 * turn[1 + axis] * 180 / M_PI /
+          (kDt / 1000);
+      trace.samples.push_back(lround(degrees_per_s * kGyroscopeSensitivity +
+                                     Noise(&seed, 100) + 20));
+    }
+    double truth[3];
+    ExpectedAngles(q, &truth[0], &truth[1], &truth[2]);
+    trace.angles.insert(trace.angles.end(), truth, truth + 3);
+    memcpy(last, q, sizeof(last));
+  }
+  return trace;
+}
+
+struct FilterScore {
+  double rms;  // Pitch and roll error, in degrees.
+  double max;
+  double yaw_max;
+  double ns;  // Per sample on the host.
+};
+
+static FilterScore ScoreFilter(const AttitudeTrace& trace, bool mahony) {
+  const int kRuns = 20;
+  int count = trace.angles.size() / 3;
+  FilterScore score = { 0, 0, 0, 0 };
+  auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < kRuns; ++run) {
+    MPU6050 mpu(0x68, kTau / 1000, kDt / 1000);
+    double squares = 0;
+    for (int i = 0; i < count; ++i) {
+      const int16_t* accel = &trace.samples[i * 6];
+      const int16_t* gyro = accel + 3;
+      int32_t pitch, roll;
+      if (mahony)
+        mpu.ComputeMahonyPitchRollQ16(accel, gyro, &pitch, &roll);
+      else
+        mpu.ComputeFilteredPitchRollQ16(accel, gyro, &pitch, &roll);
+      if (run > 0)
+        continue;
+      double errors[2] = {
+        pitch / 65536. - trace.angles[i * 3],
+        roll / 65536. - trace.angles[i * 3 + 1]
+      };
+      for (double error : errors) {
+        squares += error * error;
+        score.max = fmax(score.max, fabs(error));
+      }
+      double yaw_error = fabs(mpu.yaw_q16() / 65536. - trace.angles[i * 3 + 2]);
+      score.yaw_max = fmax(score.yaw_max, fmin(yaw_error, 360 - yaw_error));
+    }
+    if (run == 0)
+      score.rms = sqrt(squares / (2 * count));
+  }
+  auto end = std::chrono::steady_clock::now();
+  score.ns = std::chrono::duration<double, std::nano>(end - start).count() /
+      (kRuns * count);
+  return score;
+}
+
+// Sits up slowly and holds, like kAnimationStretch into kAnimationSit.
+static void SitUp(double t, double* yaw, double* pitch, double* roll) {
+  *yaw = 0;
+  *pitch = -50 * fmin(t / 2, 1);
+  *roll = 0;
+}
+
+// Turns in place at 45 degrees/s while sitting up.
+static void TurnWhileSitting(double t, double* yaw, double* pitch,
+                             double* roll) {
+  *yaw = t < 2 ? 0 : 45 * (t - 2);
+  *pitch = -45 * fmin(t / 2, 1);
+  *roll = 0;
+}
+
+// Rocks from side to side while sitting up.
+static void RockWhileSitting(double t, double* yaw, double* pitch,
+                             double* roll) {
+  *yaw = 0;
+  *pitch = -40 * fmin(t / 2, 1);
+  *roll = t < 2 ? 0 : 20 * sin((t - 2) * 3);
+}
+
+// Walks: small quick pitch and roll, and a slow turn.
+static void Walk(double t, double* yaw, double* pitch, double* roll) {
+  *yaw = 10 * t;
+  *pitch = 8 * sin(t * 9);
+  *roll = 6 * sin(t * 7);
+}
+
+// Accuracy on the traces, and time per sample on the host as a stand in for
+// cycles. The host has a 64 bit multiplier, unlike the ATmega328p, so this
+// understates the Mahony filter's cost on the robot.
+TEST(AttitudeFilterTest, MahonyAgainstComplementary) {
+  const struct {
+    const char* name;
+    Motion motion;
+    // Turns while tilted, which the complementary filter takes for tilt.
+    bool coupled;
+  } kTraces[] = {
+    { "sit up", SitUp, false },
+    { "turn while sitting", TurnWhileSitting, true },
+    { "rock while sitting", RockWhileSitting, true },
+    { "walk", Walk, false },
+  };
+  for (const auto& entry : kTraces) {
+    AttitudeTrace trace = RecordTrace(entry.motion, 12);
+    FilterScore complementary = ScoreFilter(trace, false);
+    FilterScore mahony = ScoreFilter(trace, true);
+    printf("%s: complementary %.2f rms, %.2f max degrees in %.0fns; "
+           "Mahony %.2f rms, %.2f max, %.1f yaw max in %.0fns\n", entry.name,
+           complementary.rms, complementary.max, complementary.ns,
+           mahony.rms, mahony.max, mahony.yaw_max, mahony.ns);
+    EXPECT_LT(mahony.rms, 1) << entry.name;
+    EXPECT_LT(mahony.max, 2.5) << entry.name;
+    if (entry.coupled)
+      EXPECT_LT(mahony.rms, complementary.rms * .8) << entry.name;
+    else
+      EXPECT_LT(mahony.rms, complementary.rms * 1.1) << entry.name;
+    // Yaw comes from the gyro alone, so its bias adds up.
+    EXPECT_LT(mahony.yaw_max, 10) << entry.name;
+  }
+}
+
+// A gyro that reads a steady turn the accelerometer never sees is more than
+// any real bias. The learned bias stops at the chip's zero rate tolerance.
+TEST(AttitudeFilterTest, MahonyBiasStaysInRange) {
+  const double kSampling = kDt / 1000;
+  MPU6050 mpu(0x68, kTau / 1000, kSampling);
+  const int16_t kAccel[3] = { 0, 0, int16_t(k1G) };
+  const int16_t kGyro[3] = { int16_t(250 * kGyroscopeSensitivity), 0, 0 };
+  int32_t pitch, roll;
+  double most = 0;
+  for (int i = 0; i < 60000 / kDt; ++i) {
+    mpu.ComputeMahonyPitchRollQ16(kAccel, kGyro, &pitch, &roll);
+    for (int axis = 0; axis < 3; ++axis) {
+      double degrees_per_s = mpu.bias_q38_[axis] / 274877906944. * 2 /
+          kSampling * 180 / M_PI;
+      most = fmax(most, fabs(degrees_per_s));
+    }
+  }
+  EXPECT_NEAR(20, most, .01);
+}
+
+TEST(AttitudeFilterTest, ConsumeFifoUsesTheChosenFilter) {
+  TwiDeviceFake device(0x68);
+  device.fifo_register_ = 0x74;
+  TwiBus bus;
+  bus.fake_wait_ = [&]() { device.Run(&bus); };
+  MPU6050 mpu(0x68, kTau / 1000, kDt / 1000);
+  MPU6050 reference(0x68, kTau / 1000, .005);
+  mpu.Initialize(&bus);
+  mpu.EnableFifo(4);
+  mpu.set_attitude_filter(kMahonyFilter);
+  int32_t expected_pitch = 0;
+  int32_t expected_roll = 0;
+  for (int i = 0; i < 3; ++i) {
+    const int16_t kAccel[3] = { int16_t(3000 * i), -1000, int16_t(k1G) };
+    const int16_t kGyro[3] = { int16_t(200 * i), 50, -300 };
+    for (const int16_t* values : { kAccel, kGyro }) {
+      for (int axis = 0; axis < 3; ++axis) {
+        device.fifo_.push_back(uint16_t(values[axis]) >> 8);
+        device.fifo_.push_back(values[axis] & 0xff);
+      }
+    }
+    reference.ComputeMahonyPitchRollQ16(kAccel, kGyro, &expected_pitch,
+                                        &expected_roll);
+  }
+  ASSERT_TRUE(mpu.StartFifoRead());
+  int32_t pitch, roll;
+  int samples = 0;
+  for (int i = 0; i < 4; ++i) {
+    device.Run(&bus);
+    samples += mpu.ConsumeFifo(&pitch, &roll);
+  }
+  EXPECT_EQ(3, samples);
+  EXPECT_EQ(expected_pitch, pitch);
+  EXPECT_EQ(expected_roll, roll);
+  EXPECT_EQ(reference.yaw_q16(), mpu.yaw_q16());
+  EXPECT_NE(0, mpu.yaw_q16());
+}
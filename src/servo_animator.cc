@@ -2,22 +2,18 @@
 
 #ifndef TESTING
 #include <Arduino.h>
-#define pgm_read_int8(_a) (int8_t)pgm_read_byte(_a)
 #define HDEBUG(_A)
 #define DDEBUG(_A) _A
 #else
-#define PROGMEM
-#define pgm_read_int8(_a) (*(_a))
 #include <cstdlib>
 #include <stdio.h>
 #define HDEBUG(_A) _A
 #define DDEBUG(_A)
 #endif  // TESTING
 
-#include <math.h>
 #include <string.h>
 
-#include "Instinct.h"
+#include "easing.h"
 
 static const int kPinMap[] = {
   3,  // kServoHead,
@@ -34,6 +30,11 @@ static const int kPinMap[] = {
   // kServoCount
 };
 
+// Pulse change per 1 / kAngleOne degrees in Q12.
+static const int32_t kPulseStepQ12 =
+    ((int32_t(kMaxPulseUs - kMinPulseUs) << 12) + 180 * kAngleOne / 2) /
+    (180 * kAngleOne);
+
 const int ServoAnimator::kDirectionMap[kServoCount] = {
   1,
   -1,
@@ -48,100 +49,106 @@ const int ServoAnimator::kDirectionMap[kServoCount] = {
   -1
 };
 
-const int8_t* ServoAnimator::GetFrame(int animation, int number) {
-  static int8_t result[11];
-
-  if (animation < 0 || animation >= NUM_SKILLS)
-    return nullptr;
-
-  const char* instinct = progmemPointer[animation];
-  const char* walking_frame = nullptr;
-  int total_frames = pgm_read_int8(instinct);
-  int frame_dofs = 16;
-  if (total_frames < 0) {
-    total_frames = -total_frames;
-    frame_dofs = ActualDOF;
-  } else if (total_frames > 1) {
-    frame_dofs = WalkingDOF;
-  }
-  if (number >= total_frames)
-    return nullptr;
-
-  const char* frame_start = instinct + 3 + frame_dofs * number;
-  if (frame_dofs == 16 || frame_dofs == ActualDOF) {
-    result[kServoHead] = pgm_read_int8(frame_start + 0);
-    result[kServoNeck] = pgm_read_int8(frame_start + 1);
-    result[kServoTail] = pgm_read_int8(frame_start + 2);
-    if (frame_dofs == 16)
-      walking_frame = frame_start + 8;
-    else
-      walking_frame = frame_start + 3;
-  } else if (frame_dofs == WalkingDOF) {
-    walking_frame = frame_start;
-    result[kServoHead] = 0;
-    result[kServoNeck] = 0;
-    result[kServoTail] = 0;
-  } else {
-    return nullptr;
-  }
-  result[kServoLeftFrontKnee] = pgm_read_int8(walking_frame + 4);
-  result[kServoLeftFrontShoulder] = pgm_read_int8(walking_frame + 0);
-  result[kServoRightFrontKnee] = pgm_read_int8(walking_frame + 5);
-  result[kServoRightFrontShoulder] = pgm_read_int8(walking_frame + 1);
-  result[kServoLeftBackShoulder] = pgm_read_int8(walking_frame + 3);
-  result[kServoLeftBackKnee] = pgm_read_int8(walking_frame + 7);
-  result[kServoRightBackShoulder] = pgm_read_int8(walking_frame + 2);
-  result[kServoRightBackKnee] = pgm_read_int8(walking_frame + 6);    
+// How fast each PoseLayer follows its targets by default.
+static const uint8_t kDefaultLayerMsPerDegree[kLayerCount] = {
+  2,  // kLayerBalance
+  10,  // kLayerLookAround
+  0,  // kLayerTrim
+};
+// Longest gap between ticks that layers move for in one step.
+static const unsigned int kMaxLayerStepMs = 1000;
 
-  return result;
+bool ServoAnimator::GetFrame(int animation, int number, int8_t* frame) {
+  FrameCursor cursor;
+  return cursor.Open(animation) && cursor.Read(number, frame);
 }
 
 void ServoAnimator::Initialize() {
-  // Set up pins.
-  for (int i = 0; i < kServoCount; ++i) {
-    servo_[i] = new Servo();
-  }
+  driver_.Begin();
+  for (int i = 0; i < kServoCount; ++i)
+    emitted_pulses_[i] = kNoEmittedPulse;
   ResetAnimation();
   // we cannot sense initial position from servos, so assume starting
   // at rest position.
-  memcpy(current_positions_, GetFrame(kAnimationRest, 0),
-         sizeof(current_positions_));
-  memcpy(target_unbalanced_frame_, current_positions_, sizeof(target_unbalanced_frame_));
+  GetFrame(kAnimationRest, 0, target_frame_);
+  for (int i = 0; i < kServoCount; ++i) {
+    base_positions_[i] = target_frame_[i] * kAngleOne;
+    current_positions_[i] = base_positions_[i];
+  }
+  memset(layers_, 0, sizeof(layers_));
+  for (int layer = 0; layer < kLayerCount; ++layer)
+    layers_[layer].ms_per_degree = kDefaultLayerMsPerDegree[layer];
+  layers_moving_ = false;
   animation_sequence_ = kAnimationRest;
+  ClearQueue();
 }
 
 void ServoAnimator::WriteServo(int servo, int logical_angle) {
-  if (logical_angle > eeprom_settings_->servo_upper_extents[servo])
-    logical_angle = eeprom_settings_->servo_upper_extents[servo];
-  if (logical_angle < eeprom_settings_->servo_lower_extents[servo])
-    logical_angle = eeprom_settings_->servo_lower_extents[servo];
-  int real_angle = ConvertToRealAngle(servo, logical_angle);
-  servo_[servo]->write(real_angle);
-  //printf("Writing servo %d to logical %d, real %d\n", servo, logical_angle,
-  //       real_angle);
-  current_positions_[servo] = logical_angle; 
+  const ServoMapping& mapping = mapping_[servo];
+  if (logical_angle > mapping.upper)
+    logical_angle = mapping.upper;
+  if (logical_angle < mapping.lower)
+    logical_angle = mapping.lower;
+  int pulse = mapping.zero_us +
+      ((int32_t(logical_angle) * mapping.us_per_step + (1 << 11)) >> 12);
+  current_positions_[servo] = logical_angle;
+  // Slow moves change the pulse less than 1us on most ticks, so skip
+  // repeated pulses.
+  if (pulse == emitted_pulses_[servo]) {
+    ++suppressed_writes_[servo];
+    return;
+  }
+  driver_.Write(servo, pulse);
+  //printf("Writing servo %d to logical %d, %dus\n", servo, logical_angle,
+  //       pulse);
+  emitted_pulses_[servo] = pulse;
+  ++emitted_writes_[servo];
 }
 
-
-int ServoAnimator::ConvertToRealAngle(int servo, int angle) {
-  return 90 + (angle + eeprom_settings_->servo_zero_offset[servo]) *
-      kDirectionMap[servo];
+void ServoAnimator::ResetWriteStats() {
+  memset(emitted_writes_, 0, sizeof(emitted_writes_));
+  memset(suppressed_writes_, 0, sizeof(suppressed_writes_));
 }
 
 void ServoAnimator::Attach() {
   for (int i = 0; i < kServoCount; ++i) {
-    servo_[i]->attach(kPinMap[i]);
-    WriteServo(i, current_positions_[i]);
+    driver_.Attach(i, kPinMap[i]);
+    emitted_pulses_[i] = kNoEmittedPulse;
+    WriteServo(i, ComposedPosition(i));
   }
 }
 
 void ServoAnimator::Detach() {
-  for (int i = 0; i < kServoCount; ++i)
-    servo_[i]->detach();
+  for (int i = 0; i < kServoCount; ++i) {
+    driver_.Detach(i);
+    emitted_pulses_[i] = kNoEmittedPulse;
+  }
 }
 
 void ServoAnimator::SetEepromSettings(const EepromSettings* settings) {
   eeprom_settings_ = settings;
+  BuildMappings();
+}
+
+void ServoAnimator::EepromSettingsChanged() {
+  BuildMappings();
+  // Move the servos that are not animating to their new real angles. The
+  // others pick them up on their next tick.
+  for (int i = 0; i < kServoCount; ++i)
+    WriteServo(i, ComposedPosition(i));
+}
+
+void ServoAnimator::BuildMappings() {
+  for (int i = 0; i < kServoCount; ++i) {
+    ServoMapping* mapping = &mapping_[i];
+    mapping->lower = eeprom_settings_->servo_lower_extents[i] * kAngleOne;
+    mapping->upper = eeprom_settings_->servo_upper_extents[i] * kAngleOne;
+    int real_zero = 90 + eeprom_settings_->servo_zero_offset[i] *
+        kDirectionMap[i];
+    mapping->zero_us = kMinPulseUs +
+        (int32_t(real_zero) * (kMaxPulseUs - kMinPulseUs) + 90) / 180;
+    mapping->us_per_step = kPulseStepQ12 * kDirectionMap[i];
+  }
 }
 
 // To get taller:
@@ -150,58 +157,110 @@ void ServoAnimator::SetEepromSettings(const EepromSettings* settings) {
 // To get shorter:
 // Shoulders go towards 90 (negative in back), knees go towards 0
 
-void ServoAnimator::ComputeBalancedFrame() {
-  target_balanced_frame_[0] = AngleAdd(target_unbalanced_frame_[0], pitch_);
-  target_balanced_frame_[1] = AngleAdd(target_unbalanced_frame_[1], -roll_);
-  target_balanced_frame_[2] = AngleAdd(target_unbalanced_frame_[2], -roll_ * 2);
-  bool leaning_left = roll_ > 0;
-  for (int i = int(kServoLeftFrontShoulder); i <= int(kServoLeftBackShoulder); ++i) {
-    bool is_left_leg = i == kServoLeftBackShoulder || i == kServoLeftFrontShoulder;
-    int lean_factor = is_left_leg == leaning_left ? -2 : -3;
-    int back_factor = i >= kServoRightBackShoulder ? -1 : 1;
-    target_balanced_frame_[i] = AngleAdd(target_unbalanced_frame_[i],
-        -9 * pitch_ / 10 + abs(roll_) * back_factor * -lean_factor / 2);
+void ServoAnimator::HandlePitchRoll(int pitch, int roll,
+                                    unsigned long millis_now) {
+  if (abs(pitch) > 90 * kAngleOne || abs(roll) > 90 * kAngleOne) {
+    ResetBalance();
+    return;
   }
-  for (int i = int(kServoLeftFrontKnee); i <= int(kServoLeftBackKnee); ++i) {
-    bool is_left_leg = i == kServoLeftBackKnee || i == kServoLeftFrontKnee;
-    int lean_factor = is_left_leg == leaning_left ? -2 : -3;
-    int back_factor = i >= kServoRightBackKnee ? -1 : 1;
-    target_balanced_frame_[i] = AngleAdd(target_unbalanced_frame_[i],
-        13 * pitch_ / 10 + abs(roll_) * back_factor * lean_factor * 7 / 10);
+  // The gains hold however often samples come in.
+  unsigned long elapsed = millis_now - balance_millis_;
+  balance_millis_ = millis_now;
+  if (elapsed > kMaxBalanceStepMs)
+    elapsed = kMaxBalanceStepMs;
+  int pitch_correction = pitch_balance_.Update(
+      eeprom_settings_->pitch_gains, pitch - pitch_setpoint_ * kAngleOne,
+      elapsed);
+  int roll_correction = roll_balance_.Update(
+      eeprom_settings_->roll_gains, roll - roll_setpoint_ * kAngleOne,
+      elapsed);
+  const int8_t* roll_mix = roll_correction > 0 ?
+      eeprom_settings_->balance_roll_left_mix :
+      eeprom_settings_->balance_roll_right_mix;
+  for (int i = 0; i < kServoCount; ++i) {
+    // Q4 corrections times Q4 mixes, rounded to degrees.
+    int32_t offset =
+        int32_t(eeprom_settings_->balance_pitch_mix[i]) * pitch_correction +
+        int32_t(roll_mix[i]) * roll_correction;
+    SetLayerOffset(kLayerBalance, i, (offset + 128) >> 8);
   }
 }
 
-void ServoAnimator::HandlePitchRoll(int pitch, int roll, unsigned long millis_now) {
-  bool any_change = false;
-  if (abs(pitch) > 90 || abs(roll) > 90) {
-    pitch = 0;
-    roll = 0;
-  }
-  if (abs(pitch_ - pitch) >= 10) {
-    pitch_ = pitch;
-    any_change = true;
-  }
-  if (abs(roll_ - roll) >= 10) {
-    roll_ = roll;
-    any_change = true;
-  }
-  if (any_change) {
-    SetFrame(target_unbalanced_frame_, millis_now);
+void ServoAnimator::ResetBalance() {
+  pitch_balance_.Reset();
+  roll_balance_.Reset();
+  ClearLayer(kLayerBalance);
+}
+
+void ServoAnimator::SetLayerOffset(PoseLayer layer, int servo, int offset) {
+  if (offset > 127)
+    offset = 127;
+  if (offset < -127)
+    offset = -127;
+  OffsetLayer* pose_layer = &layers_[layer];
+  pose_layer->target[servo] = offset;
+  if (pose_layer->offset[servo] != offset * kAngleOne)
+    layers_moving_ = true;
+}
+
+void ServoAnimator::ClearLayer(PoseLayer layer) {
+  for (int i = 0; i < kServoCount; ++i)
+    SetLayerOffset(layer, i, 0);
+}
+
+// Moves the layer offsets towards their targets for elapsed ms and returns a
+// mask of the servos whose offsets changed.
+uint16_t ServoAnimator::StepLayers(unsigned long elapsed) {
+  if (!layers_moving_)
+    return 0;
+  if (elapsed > kMaxLayerStepMs)
+    elapsed = kMaxLayerStepMs;
+  uint16_t moved = 0;
+  layers_moving_ = false;
+  for (int layer = 0; layer < kLayerCount; ++layer) {
+    OffsetLayer* pose_layer = &layers_[layer];
+    unsigned int step = 0;
+    if (pose_layer->ms_per_degree) {
+      step = elapsed * kAngleOne / pose_layer->ms_per_degree;
+      if (step == 0)
+        step = 1;
+    }
+    for (int i = 0; i < kServoCount; ++i) {
+      int target = pose_layer->target[i] * kAngleOne;
+      int offset = pose_layer->offset[i];
+      if (offset == target)
+        continue;
+      if (step == 0 || unsigned(abs(target - offset)) <= step)
+        offset = target;
+      else if (offset < target)
+        offset += step;
+      else
+        offset -= step;
+      pose_layer->offset[i] = offset;
+      moved |= 1 << i;
+      if (offset != target)
+        layers_moving_ = true;
+    }
   }
+  return moved;
 }
 
-int ServoAnimator::AngleAdd(int a1, int a2) {
-  int result = a1 + a2;
-  if (result < -127)
-    return -127;
-  if (result > 128)
-    return 128;
-  return result;
+int ServoAnimator::ComposedPosition(int servo) const {
+  int angle = base_positions_[servo];
+  for (int layer = 0; layer < kLayerCount; ++layer)
+    angle += layers_[layer].offset[servo];
+  return angle;
 }
 
 void ServoAnimator::StartFrame(const int8_t* new_frame, unsigned long millis_now) {
-  SetFrame(new_frame, millis_now);
+  ClearQueue();
+  stop_frame_ = kNoStableFrame;
   animation_sequence_ = kAnimationSingleFrame;
+  cursor_.Close();
+  spline_moving_ = false;
+  pitch_setpoint_ = 0;
+  roll_setpoint_ = 0;
+  SetFrame(new_frame, millis_now);
 }
 
 void ServoAnimator::SetFrame(const int8_t* new_frame, unsigned long millis_now) {
@@ -211,25 +270,354 @@ void ServoAnimator::SetFrame(const int8_t* new_frame, unsigned long millis_now)
 #endif
     return;
   }
-  memcpy(start_frame_, current_positions_, sizeof(start_frame_));
-  memcpy(target_unbalanced_frame_, new_frame, sizeof(target_unbalanced_frame_));
-  ComputeBalancedFrame();
+  memcpy(target_frame_, new_frame, sizeof(target_frame_));
+  PlanSegment();
   millis_start_ = millis_now;
   animating_ = true;
 }
 
+void ServoAnimator::PlanSegment() {
+  // Servos already at their target are left out so that each tick only
+  // touches the servos that move.
+  segment_servos_ = 0;
+  segment_ms_ = 0;
+  spline_segment_ = interpolation_mode_ == kInterpolateSpline && cyclic();
+  if (spline_segment_) {
+    PlanSplineSegment();
+    return;
+  }
+  spline_moving_ = false;
+  for (int i = 0; i < kServoCount; ++i) {
+    int total_angle_motion = target_frame_[i] * kAngleOne - base_positions_[i];
+    if (total_angle_motion == 0)
+      continue;
+    ServoSegment* segment = &segment_[segment_servos_++];
+    segment->servo = i;
+    segment->start = base_positions_[i];
+    segment->delta = total_angle_motion;
+    // Rounded up so that a fraction of a degree still takes time.
+    segment->ms = (uint32_t(abs(total_angle_motion)) * ms_per_degree_ +
+                   kAngleOne - 1) >> kAngleFractionBits;
+    if (segment->ms > segment_ms_)
+      segment_ms_ = segment->ms;
+  }
+
+  unsigned int ms = segment_ms_;
+  if (max_segment_ms_ && ms > max_segment_ms_)
+    ms = max_segment_ms_;
+  CapSegment(ms);
+}
+
+// Shortens the segment to at most ms, speeding up the servos that would take
+// longer, and gives every servo the segment's time unless each keeps its own.
+void ServoAnimator::CapSegment(unsigned int ms) {
+  if (segment_ms_ > ms)
+    segment_ms_ = ms;
+  for (uint8_t i = 0; i < segment_servos_; ++i) {
+    ServoSegment* segment = &segment_[i];
+    if (interpolation_mode_ != kInterpolatePerServo ||
+        segment->ms > segment_ms_)
+      segment->ms = segment_ms_;
+    segment->reciprocal = PortionReciprocal(segment->ms);
+  }
+}
+
+// Returns how long the segment between two keyframes of the playing sequence
+// takes when the servos start on the first one.
+unsigned int ServoAnimator::KeyframeMs(const int8_t* from,
+                                       const int8_t* to) const {
+  int max_delta = 0;
+  for (int i = 0; i < kServoCount; ++i) {
+    int delta = abs(to[i] - from[i]);
+    if (delta > max_delta)
+      max_delta = delta;
+  }
+  if (interpolation_mode_ == kInterpolateSpline)
+    return SplineSegmentMs(max_delta * kAngleOne);
+  unsigned int ms = max_delta * ms_per_degree_;
+  if (max_segment_ms_ && ms > max_segment_ms_)
+    ms = max_segment_ms_;
+  return ms;
+}
+
+// Returns the time of a spline segment whose largest move is max_delta, in
+// 1 / kAngleOne degrees.
+unsigned int ServoAnimator::SplineSegmentMs(unsigned int max_delta) const {
+  // 41722 / 2^16 is 2 / PI.
+  unsigned int ms = (uint32_t(max_delta) * ms_per_degree_ * 41722) >>
+      (16 + kAngleFractionBits);
+  if (max_segment_ms_ && ms > max_segment_ms_)
+    ms = max_segment_ms_;
+  return ms;
+}
+
+// Plans one segment of a Catmull-Rom spline through the frames of a looping
+// sequence. The tangent at each keyframe is the average velocity between its
+// neighbours, scaled by the segment durations so that the velocity stays
+// continuous even when neighbouring segments take different times.
+void ServoAnimator::PlanSplineSegment() {
+  int8_t following[kServoCount];
+  if (!PeekSequenceFrame(following))
+    memcpy(following, target_frame_, sizeof(following));
+  int max_delta = 0;
+  int max_following_delta = 0;
+  for (int i = 0; i < kServoCount; ++i) {
+    int delta = abs(target_frame_[i] * kAngleOne - base_positions_[i]);
+    if (delta > max_delta)
+      max_delta = delta;
+    delta = abs(following[i] - target_frame_[i]) * kAngleOne;
+    if (delta > max_following_delta)
+      max_following_delta = delta;
+  }
+  unsigned int ms = SplineSegmentMs(max_delta);
+  unsigned int following_ms = SplineSegmentMs(max_following_delta);
+  // Starting from a standstill, or after a pose, leaves with zero velocity.
+  uint16_t start_weight = 0;
+  if (spline_moving_ && ms + spline_previous_ms_ > 0)
+    start_weight = (uint32_t(ms) << 15) / (ms + spline_previous_ms_);
+  uint16_t end_weight = 0;
+  if (ms + following_ms > 0)
+    end_weight = (uint32_t(ms) << 15) / (ms + following_ms);
+  uint32_t reciprocal = PortionReciprocal(ms);
+
+  for (int i = 0; i < kServoCount; ++i) {
+    int start = base_positions_[i];
+    int target = target_frame_[i] * kAngleOne;
+    int tangent_start = ScaleQ15(target - spline_previous_start_[i],
+                                 start_weight);
+    int tangent_end = ScaleQ15(following[i] * kAngleOne - start, end_weight);
+    spline_previous_start_[i] = start;
+    if (target == start && tangent_start == 0 && tangent_end == 0)
+      continue;
+    ServoSegment* segment = &segment_[segment_servos_++];
+    segment->servo = i;
+    segment->start = start;
+    segment->delta = target - start;
+    segment->ms = ms;
+    segment->reciprocal = reciprocal;
+    segment->tangent_start = tangent_start;
+    segment->tangent_end = tangent_end;
+  }
+  segment_ms_ = ms;
+  spline_previous_ms_ = ms;
+  spline_moving_ = true;
+}
+
 void ServoAnimator::ResetAnimation() {
   animating_ = false;
+  spline_moving_ = false;
   millis_start_ = 0;
-  memset(start_frame_, 0, sizeof(start_frame_));
-  memset(target_balanced_frame_, 0, sizeof(target_balanced_frame_));
+  segment_servos_ = 0;
+  segment_ms_ = 0;
 }
 
 void ServoAnimator::StartAnimation(int animation, unsigned long millis_now) {
+  ClearQueue();
+  StartSequence(animation, nullptr, millis_now);
+}
+
+void ServoAnimator::StartTransformedAnimation(int animation,
+                                              const GaitTransform& transform,
+                                              unsigned long millis_now) {
+  ClearQueue();
+  StartSequence(animation, &transform, millis_now);
+}
+
+void ServoAnimator::StopAtStableFrame(int animation,
+                                      unsigned long millis_now) {
+  uint8_t stable[kStableFramesPerSkill];
+  if (!animating_ || !cyclic() || !StableFrames(stable)) {
+    StartAnimation(animation, millis_now);
+    return;
+  }
+  ClearQueue();
+  // The stable frame reached first from the one the servos move to.
+  uint8_t count = SequenceFrameCount();
+  uint8_t nearest_ahead = count;
+  for (int i = 0; i < kStableFramesPerSkill; ++i) {
+    if (stable[i] >= count)
+      continue;
+    uint8_t ahead =
+        (stable[i] + count - animation_sequence_frame_number_) % count;
+    if (ahead < nearest_ahead) {
+      nearest_ahead = ahead;
+      stop_frame_ = stable[i];
+    }
+  }
+  stop_animation_ = animation;
+}
+
+bool ServoAnimator::StableFrames(uint8_t* frames) const {
+  if (animation_sequence_ == kAnimationGait) {
+    gait_.StableSteps(frames);
+    return true;
+  }
+  SkillInfo info;
+  if (!GetSkillInfo(cursor_.animation(), &info) ||
+      info.stable_frames[0] == kNoStableFrame)
+    return false;
+  memcpy(frames, info.stable_frames, sizeof(info.stable_frames));
+  return true;
+}
+
+bool ServoAnimator::QueueAnimation(int animation, uint8_t repeats,
+                                   unsigned int hold_ms) {
+  if (queue_count_ == kAnimationQueueSize)
+    return false;
+  AnimationCommand* command =
+      &queue_[(queue_first_ + queue_count_) % kAnimationQueueSize];
+  command->animation = animation;
+  command->repeats = repeats;
+  command->hold_ms = hold_ms;
+  ++queue_count_;
+  return true;
+}
+
+void ServoAnimator::ClearQueue() {
+  queue_count_ = 0;
+  command_playing_ = false;
+  command_holding_ = false;
+}
+
+// Ends the hold of the first command once it has passed, and starts the
+// first command if it is not playing yet.
+void ServoAnimator::RunQueue(unsigned long millis_now) {
+  if (command_holding_ &&
+      millis_now - hold_start_ >= queue_[queue_first_].hold_ms)
+    FinishCommand(millis_now);
+  if (!command_playing_ && queue_count_ > 0)
+    StartCommand(millis_now);
+}
+
+void ServoAnimator::StartCommand(unsigned long millis_now) {
+  const AnimationCommand& command = queue_[queue_first_];
+  command_playing_ = true;
+  cycles_left_ = command.repeats;
+  if (!StartSequence(command.animation, nullptr, millis_now))
+    EndCommand(millis_now);
+}
+
+// The first command reached its last frame. Holds it, if asked to, before
+// finishing.
+void ServoAnimator::EndCommand(unsigned long millis_now) {
+  ResetAnimation();
+  if (queue_[queue_first_].hold_ms > 0) {
+    command_holding_ = true;
+    hold_start_ = millis_now;
+  } else {
+    FinishCommand(millis_now);
+  }
+}
+
+void ServoAnimator::FinishCommand(unsigned long millis_now) {
+  int animation = queue_[queue_first_].animation;
+  queue_first_ = (queue_first_ + 1) % kAnimationQueueSize;
+  --queue_count_;
+  command_playing_ = false;
+  command_holding_ = false;
+  if (observer_ != nullptr)
+    observer_->OnAnimationDone(animation);
+  // Unless the observer started something else.
+  if (!command_playing_ && queue_count_ > 0)
+    StartCommand(millis_now);
+}
+
+bool ServoAnimator::StartSequence(int animation,
+                                  const GaitTransform* transform,
+                                  unsigned long millis_now) {
+  int8_t frame[kServoCount];
+  // Not animating_, which EndCommand clears before the next command starts,
+  // so that commands queued after a gait switch from it as well.
+  bool switching = cyclic();
+  uint16_t phase = switching ? SequencePhase() : 0;
+  stop_frame_ = kNoStableFrame;
   animation_sequence_ = animation;
   animation_sequence_frame_number_ = 0;
+  spline_moving_ = false;
   Attach();
-  SetFrame(GetFrame(animation, 0), millis_now);
+  bool valid = true;
+  if (animation == kAnimationGait) {
+    cursor_.Close();
+    gait_.Reset();
+  } else {
+    valid = cursor_.Open(animation);
+    if (valid && transform != nullptr)
+      cursor_.set_transform(*transform);
+  }
+  SkillInfo info;
+  bool posture = GetSkillInfo(animation, &info);
+  pitch_setpoint_ = posture ? info.pitch : 0;
+  roll_setpoint_ = posture ? info.roll : 0;
+  if (valid && switching && cyclic())
+    SeekEntryFrame(phase);
+  valid = valid && NextSequenceFrame(frame);
+  if (valid && cyclic()) {
+    uint8_t count = SequenceFrameCount();
+    cycle_end_frame_ = (animation_sequence_frame_number_ + count - 1) % count;
+  }
+  SetFrame(valid ? frame : nullptr, millis_now);
+  return valid;
+}
+
+uint8_t ServoAnimator::SequenceFrameCount() const {
+  if (animation_sequence_ == kAnimationGait)
+    return gait_.frames_per_cycle();
+  return cursor_.frame_count();
+}
+
+// Q16 fraction of its cycle the current keyframe is at.
+uint16_t ServoAnimator::SequencePhase() const {
+  return (uint32_t(animation_sequence_frame_number_) << 16) /
+      SequenceFrameCount();
+}
+
+// Number of the frame of the opened sequence that the servos reach soonest
+// from where the base animation has them.
+uint8_t ServoAnimator::NearestFrame() const {
+  GaitGenerator gait = gait_;
+  FrameCursor cursor = cursor_;
+  gait.Reset();
+  cursor.Rewind();
+  uint8_t count = SequenceFrameCount();
+  uint8_t nearest = 0;
+  int nearest_distance = 0;
+  for (uint8_t number = 0; number < count; ++number) {
+    int8_t frame[kServoCount];
+    if (animation_sequence_ == kAnimationGait)
+      gait.Next(frame);
+    else
+      cursor.Next(frame);
+    int distance = 0;
+    for (int i = 0; i < kServoCount; ++i) {
+      int delta = abs(frame[i] * kAngleOne - base_positions_[i]);
+      if (delta > distance)
+        distance = delta;
+    }
+    if (number == 0 || distance < nearest_distance) {
+      nearest_distance = distance;
+      nearest = number;
+    }
+  }
+  return nearest;
+}
+
+// Leaves the just opened sequence where NextSequenceFrame produces the frame
+// switch_mode_ enters it at. phase is where the replaced sequence was.
+void ServoAnimator::SeekEntryFrame(uint16_t phase) {
+  uint8_t count = SequenceFrameCount();
+  uint8_t entry = 0;
+  if (switch_mode_ == kSwitchNearestPose)
+    entry = NearestFrame();
+  else if (switch_mode_ == kSwitchMatchPhase)
+    entry = (uint32_t(phase) * count + 0x8000) >> 16;
+  if (entry >= count)
+    entry = 0;
+  if (animation_sequence_ == kAnimationGait) {
+    gait_.set_step(entry);
+  } else if (entry > 0) {
+    int8_t frame[kServoCount];
+    cursor_.Read(entry - 1, frame);
+  }
 }
 
 void ServoAnimator::WaitUntilDone() const {
@@ -240,93 +628,154 @@ void ServoAnimator::WaitUntilDone() const {
   }
 }
 
+// Moves the base animation along the current segment, adding the servos it
+// moved to the mask in moved.
 void ServoAnimator::InterpolateToFrame(unsigned long millis_now,
-                                       bool* done) {
-  *done = false;
-  if (millis_last_ == millis_now) {
-    // Already ran at this millis clock, no updates possible.
-    return;
-  }
-  millis_last_ = millis_now;
-
-  bool any_not_done = false;
+                                       uint16_t* moved, bool* done) {
   unsigned long millis_elapsed = millis_now - millis_start_;
 
-  for (int i = 0; i < kServoCount; ++i) {
+  for (uint8_t i = 0; i < segment_servos_; ++i) {
     // Interpolate with smooth curve an angle transition based on
     // ms_per_degree.
-    int total_angle_motion = target_balanced_frame_[i] - start_frame_[i];
-    int abs_total_angle_motion = total_angle_motion;
-    if (abs_total_angle_motion < 0)
-      abs_total_angle_motion = -abs_total_angle_motion;
-    int ms_for_angle_motion = abs_total_angle_motion * ms_per_degree_;
-    float portion_done;
-    if (ms_for_angle_motion == 0) {
-      //printf("@%lums, servo %d: no motion\n", millis_now, i);
-      portion_done = 1;
+    const ServoSegment& segment = segment_[i];
+    uint16_t portion_done = PortionQ15(millis_elapsed, segment.ms,
+                                       segment.reciprocal);
+    int motion;
+    if (spline_segment_) {
+      motion = HermiteQ15(segment.delta, segment.tangent_start,
+                          segment.tangent_end, portion_done);
     } else {
-      portion_done = (float)millis_elapsed / ms_for_angle_motion;
-      if (portion_done > 1.0) portion_done = 1;
+      motion = ScaleQ15(segment.delta, EaseCosineQ15(portion_done));
     }
-    float portion_done_smoothed = (1 - cos(portion_done * M_PI)) / 2;
-    int rounded_angle_motion;
-    if (total_angle_motion > 0)
-      rounded_angle_motion = portion_done_smoothed * total_angle_motion + .5;
-    else
-      rounded_angle_motion = portion_done_smoothed * total_angle_motion - .5;
-    int angle_at_portion = start_frame_[i] + rounded_angle_motion;
-    //printf("@%lums, %d: %d abs motion, %f (%f smoothed) done (%lu/%d), start %d, progress %d, logical angle %d\n", millis_now, i, abs_total_angle_motion, (double)portion_done, (double)portion_done_smoothed, millis_elapsed, ms_for_angle_motion, start_frame_[i], rounded_angle_motion, angle_at_portion);
-#ifndef TESTING
-#if 0
-    Serial.print("Servo ");
-    Serial.print(i);
-    Serial.print(": ");
-    Serial.print(new_frame[i]);
-    Serial.print(", zeroed ");
-    Serial.print(servo_zero_offsets_[i]);
-    Serial.print(" so setting to ");
-    Serial.println(angle);
-#endif
-#endif
-    WriteServo(i, angle_at_portion);
-    if (portion_done < 1.0)
-      any_not_done = true;
+    base_positions_[segment.servo] = segment.start + motion;
+    *moved |= 1 << segment.servo;
+  }
+
+  *done = millis_elapsed >= segment_ms_;
+}
+
+// Decodes the next frame of cursor, wrapping around skills of several frames.
+static bool NextCyclicFrame(FrameCursor* cursor, int8_t* frame) {
+  if (cursor->Next(frame))
+    return true;
+  if (cursor->frame_count() <= 1)
+    return false;
+  cursor->Rewind();
+  return cursor->Next(frame);
+}
+
+bool ServoAnimator::cyclic() const {
+  if (animation_sequence_ == kAnimationGait)
+    return true;
+  return animation_sequence_ != kAnimationSingleFrame &&
+      cursor_.frame_count() > 1;
+}
+
+// Produces the next frame of the playing sequence, looping cyclic ones.
+// Returns false once a sequence of a single frame has played.
+bool ServoAnimator::NextSequenceFrame(int8_t* frame) {
+  if (animation_sequence_ == kAnimationGait) {
+    animation_sequence_frame_number_ = gait_.step();
+    gait_.Next(frame);
+    return true;
+  }
+  if (!NextCyclicFrame(&cursor_, frame))
+    return false;
+  animation_sequence_frame_number_ = cursor_.frame_number() - 1;
+  return true;
+}
+
+// Like NextSequenceFrame, but leaves the sequence where it is.
+bool ServoAnimator::PeekSequenceFrame(int8_t* frame) const {
+  if (animation_sequence_ == kAnimationGait) {
+    GaitGenerator gait = gait_;
+    gait.Next(frame);
+    return true;
   }
+  FrameCursor cursor = cursor_;
+  return NextCyclicFrame(&cursor, frame);
+}
 
-  *done = !any_not_done;
-  //printf("At end: %d\n", any_not_done);
+// Whether the frame the sequence is at ends a cycle of the playing command,
+// counted from the frame it entered at.
+bool ServoAnimator::CycleEnds() const {
+  return command_playing_ && cyclic() &&
+      animation_sequence_frame_number_ == cycle_end_frame_;
 }
 
 void ServoAnimator::StartNextAnimationFrame(unsigned long millis_now) {
-  animation_sequence_frame_number_++;
-  const int8_t* next_frame =
-      GetFrame(animation_sequence_, animation_sequence_frame_number_);
-  if (next_frame == nullptr) {
-    if (animation_sequence_frame_number_ == 1) {
-      if (animation_sequence_ == kAnimationRest ||
-          animation_sequence_ == kAnimationRestLaidOut) {
-        // TODO: Create an observer interface and use it detach when we
-        // observe Rest animation finishing.
-        Detach();
-      }
-      ResetAnimation();
+  if (animation_sequence_frame_number_ == stop_frame_) {
+    StartSequence(stop_animation_, nullptr, millis_now);
+    return;
+  }
+  if (CycleEnds()) {
+    // A cycle of the command ended.
+    bool done = cycles_left_ == kRepeatUntilNext ? queue_count_ > 1 :
+        --cycles_left_ == 0;
+    if (done) {
+      EndCommand(millis_now);
       return;
     }
-
-    animation_sequence_frame_number_ = 0;
-    next_frame = GetFrame(animation_sequence_, animation_sequence_frame_number_);
   }
+  int8_t next_frame[kServoCount];
+  if (!NextSequenceFrame(next_frame)) {
+    // Resting poses leave the servos limp.
+    if (animation_sequence_ == kAnimationRest ||
+        animation_sequence_ == kAnimationRestLaidOut)
+      Detach();
+    ResetAnimation();
+    if (command_playing_)
+      EndCommand(millis_now);
+    else if (observer_ != nullptr)
+      observer_->OnAnimationDone(animation_sequence_);
+    return;
+  }
+
+  if (cadence_locked_ && cyclic())
+    StartCadenceFrame(next_frame, millis_now);
+  else
+    SetFrame(next_frame, millis_now);
+}
 
-  SetFrame(next_frame, millis_now);
+// Starts the segment to next_frame when it was due rather than now, so that a
+// late loop does not slow the stride down. Frames whose whole segment is
+// already in the past are skipped, and the servos catch up on the rest.
+void ServoAnimator::StartCadenceFrame(int8_t* next_frame,
+                                      unsigned long millis_now) {
+  const uint8_t kMaxSkippedFrames = 255;
+  unsigned long due = millis_start_ + segment_ms_;
+  cadence_lag_ms_ += millis_now - due;
+  unsigned int ms = KeyframeMs(target_frame_, next_frame);
+  for (uint8_t skipped = 0;
+       due + ms <= millis_now && skipped < kMaxSkippedFrames &&
+       animation_sequence_frame_number_ != stop_frame_ && !CycleEnds();
+       ++skipped) {
+    int8_t skipped_frame[kServoCount];
+    memcpy(skipped_frame, next_frame, sizeof(skipped_frame));
+    NextSequenceFrame(next_frame);
+    due += ms;
+    ms = KeyframeMs(skipped_frame, next_frame);
+    ++skipped_frames_;
+    // The skipped keyframe no longer shapes the spline.
+    spline_moving_ = false;
+  }
+  SetFrame(next_frame, due);
+  CapSegment(ms);
 }
 
 void ServoAnimator::Animate(unsigned long millis_now) {
-  if (!animating_) {
+  RunQueue(millis_now);
+  if (!animating_ && !layers_moving_) {
+    millis_last_ = millis_now;
 #ifdef TESTING
     printf("@%lums, not animating\n", millis_now);
 #endif
     return;
   }
+  if (millis_last_ == millis_now) {
+    // Already ran at this millis clock, no updates possible.
+    return;
+  }
 
 #ifndef TESTING
   if (millis_last_ && millis_now - millis_last_ > 10) {
@@ -337,9 +786,15 @@ void ServoAnimator::Animate(unsigned long millis_now) {
   }
 #endif
 
-  bool done_interpolation;
-
-  InterpolateToFrame(millis_now, &done_interpolation);
+  uint16_t moved = StepLayers(millis_now - millis_last_);
+  millis_last_ = millis_now;
+  bool done_interpolation = false;
+  if (animating_)
+    InterpolateToFrame(millis_now, &moved, &done_interpolation);
+  for (int i = 0; i < kServoCount; ++i) {
+    if (moved & (1 << i))
+      WriteServo(i, ComposedPosition(i));
+  }
 
   if (done_interpolation) {
     if (animation_sequence_ == kAnimationSingleFrame)
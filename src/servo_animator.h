@@ -1,78 +1,71 @@
 #ifndef _SERVO_ANIMATOR_H
 #define _SERVO_ANIMATOR_H
 
-#ifndef TESTING
-#include <Servo.h>
-#else
-
-class EepromSettings;
+#include "balance_controller.h"
+#include "eeprom_settings.h"
+#include "gait_generator.h"
+#include "servo_driver.h"
+#include "skills.h"
 
-class Servo {
- public:
-  Servo() {}
+const int kAnimationSingleFrame = -1;
+// Endless walk produced by the GaitGenerator instead of stored frames.
+const int kAnimationGait = 64;
 
-  void attach(int pin) {
-    this->pin = pin;
-    attached = true;
-  }
+const int kDefaultMsPerDegree = 1;
 
-  void detach() {
-    attached = false;
-  }
+// Commands the animation queue holds, including the one playing.
+const int kAnimationQueueSize = 4;
+// Repeat count that loops a cyclic sequence until a later command is queued.
+const uint8_t kRepeatUntilNext = 0;
 
-  void write(int value) {
-    this->value = value;
-  }
+// Interpolated angles carry this many fraction bits down to the servo pulse.
+const int kAngleFractionBits = 4;
+const int kAngleOne = 1 << kAngleFractionBits;
 
-  int pin = 0;
-  int value = 0;
-  bool attached = false;
+// How the servos of one segment share time.
+enum InterpolationMode {
+  // Each servo moves for abs(delta) * ms_per_degree and then waits for the
+  // slowest one.
+  kInterpolatePerServo,
+  // Every servo moves for the slowest servo's duration, so all arrive at the
+  // next frame together.
+  kInterpolateSynchronized,
+  // Looping sequences follow a Catmull-Rom spline through their frames, so
+  // servos keep moving across keyframes instead of stopping at each one.
+  // Segments take 2/PI of the synchronized time, which keeps the peak speed
+  // of the cosine ease. Single frames play like kInterpolateSynchronized.
+  kInterpolateSpline,
 };
 
-#endif  // TESTING
-
-
-#include "eeprom_settings.h"
+// Which frame a looping sequence starts from when it replaces another one
+// that is playing.
+enum SwitchMode {
+  kSwitchFromStart,
+  // The frame whose largest joint move from the current pose is smallest.
+  kSwitchNearestPose,
+  // The frame at the same fraction of its cycle as the replaced sequence.
+  kSwitchMatchPhase,
+};
 
-const int kAnimationRest = 37;
-const int kAnimationCalibrationPose = 18;
-const int kAnimationSleep = 39;
-const int kAnimationStretch = 40;
-const int kAnimationBalance = 16;
-const int kAnimationSit = 38;
-const int kAnimationWalk = 13;
-const int kAnimationWalkLeft = 14;
-const int kAnimationWalkRight = 15;
-const int kAnimationBackUp = 1;
-const int kAnimationBackUpLeft = 2;
-const int kAnimationBackUpRight = 3;
-const int kAnimationCrawl = 4;
-const int kAnimationCrawlLeft = 5;
-const int kAnimationCrawlRight = 6;
-const int kAnimationTr = 9;
-const int kAnimationTrLeft = 10;
-const int kAnimationTrRight = 11;
-const int kAnimationWalkInPlace = 12;
-const int kAnimationSingleFrame = -1;
-const int kAnimationFistBump = 42;
-const int kAnimationRestLaidOut = 43;
-
-enum ServoIndex {
-  kServoHead,
-  kServoNeck,
-  kServoTail,
-  kServoLeftFrontShoulder,
-  kServoRightFrontShoulder,
-  kServoRightBackShoulder,
-  kServoLeftBackShoulder,
-  kServoLeftFrontKnee,
-  kServoRightFrontKnee,
-  kServoRightBackKnee,
-  kServoLeftBackKnee,
-  kServoCount
+// Offsets added to the base animation, in the order they are applied. Each
+// layer eases towards its own targets at its own rate, without disturbing the
+// segments of the base animation.
+enum PoseLayer {
+  kLayerBalance,  // Set from the body's pitch and roll by HandlePitchRoll.
+  kLayerLookAround,  // Head and neck glances of AutoMode.
+  kLayerTrim,  // User adjustments.
+  kLayerCount
 };
 
-const int kDefaultMsPerDegree = 1;
+// Told when the ServoAnimator finishes an animation.
+class AnimationObserver {
+ public:
+  // A sequence of a single frame reached its frame, or a queued command
+  // finished playing and holding. Called from Animate, and may start or
+  // queue animations.
+  virtual void OnAnimationDone(int animation) = 0;
+  virtual ~AnimationObserver() {}
+};
 
 class ServoAnimator {
  public:
@@ -80,53 +73,234 @@ class ServoAnimator {
 
   void Initialize();
   virtual void StartAnimation(int animation, unsigned long millis_now);
+  // Plays animation with transform in place of its own, e.g. to turn a
+  // straight gait by shrinking one side.
+  void StartTransformedAnimation(int animation, const GaitTransform& transform,
+                                 unsigned long millis_now);
+  // Lets a playing gait go on to the next of its stable frames, see
+  // SkillInfo, and then starts animation from there. Other sequences start
+  // animation at once.
+  void StopAtStableFrame(int animation, unsigned long millis_now);
+  bool stopping() const { return stop_frame_ != kNoStableFrame; }
+  // Appends a command that plays animation, looping a cyclic one for repeats
+  // cycles or, with kRepeatUntilNext, until a later command is queued, and
+  // then holds its last frame for hold_ms. Sequences of a single frame play
+  // once. Each command starts from Animate once the one before is done.
+  // Returns false if the queue is full.
+  bool QueueAnimation(int animation, uint8_t repeats, unsigned int hold_ms);
+  // Drops the queued commands. A sequence that one of them started plays on
+  // as if started by StartAnimation, which like StartFrame clears the queue.
+  void ClearQueue();
+  int queued_commands() const { return queue_count_; }
+  void set_observer(AnimationObserver* observer) { observer_ = observer; }
   void WaitUntilDone() const;
   void Rest();
   void Attach();
   void Detach();
   void SetEepromSettings(const EepromSettings* settings);
+  // Rebuilds the logical to real angle mapping after the zero offsets or
+  // extents of the settings changed.
+  void EepromSettingsChanged();
   void StartFrame(const int8_t* servo_values, unsigned long millis_now);
-  const int8_t* GetFrame(int animation, int number);
+  // Decodes one frame of animation into frame, which holds kServoCount values.
+  static bool GetFrame(int animation, int number, int8_t* frame);
   void Animate(unsigned long millis_now);
   bool animating() const { return animating_; }
   void set_ms_per_degree(int ms) { ms_per_degree_ = ms; }
   int ms_per_degree() const { return ms_per_degree_; }
+  void set_interpolation_mode(InterpolationMode mode) {
+    interpolation_mode_ = mode;
+  }
+  InterpolationMode interpolation_mode() const { return interpolation_mode_; }
+  // Caps every segment at ms, raising the step rate of slow frames at the
+  // cost of faster servo motion. 0 removes the cap.
+  void set_max_segment_ms(unsigned int ms) { max_segment_ms_ = ms; }
+  unsigned int max_segment_ms() const { return max_segment_ms_; }
+  // Gives each keyframe of a looping sequence a due time. A segment starts
+  // when its keyframe was due even if Animate runs late, and keyframes whose
+  // time has passed are skipped, keeping the stride frequency constant.
+  void set_cadence_locked(bool locked) { cadence_locked_ = locked; }
+  bool cadence_locked() const { return cadence_locked_; }
+  // Keyframes skipped, and the total ms keyframes started late, since the
+  // last ResetCadenceStats.
+  unsigned int skipped_frames() const { return skipped_frames_; }
+  unsigned long cadence_lag_ms() const { return cadence_lag_ms_; }
+  void ResetCadenceStats() {
+    skipped_frames_ = 0;
+    cadence_lag_ms_ = 0;
+  }
+  void set_switch_mode(SwitchMode mode) { switch_mode_ = mode; }
+  SwitchMode switch_mode() const { return switch_mode_; }
   int animation_sequence() const { return animation_sequence_; }
+  // Parameters of kAnimationGait. Changes apply from the next frame on.
+  GaitGenerator* gait() { return &gait_; }
   int animation_sequence_frame_number() const {
     return animation_sequence_frame_number_;
   }
+  // Writes that reached the servo, and writes skipped because the servo was
+  // already at that pulse width, since the last ResetWriteStats.
+  uint32_t emitted_writes(int servo) const {
+    return emitted_writes_[servo];
+  }
+  uint32_t suppressed_writes(int servo) const {
+    return suppressed_writes_[servo];
+  }
+  void ResetWriteStats();
+  // Feeds one pitch and roll sample, in 1 / kAngleOne degrees, taken at
+  // millis_now to the balance controllers and moves the balance layer to
+  // their corrections. The controllers hold the pitch and roll of the last
+  // skill started, see SkillInfo. Tilts beyond 90 degrees reset the balance.
   void HandlePitchRoll(int pitch, int roll, unsigned long millis_now);
-  static int AngleAdd(int a1, int a2);
+  // Levels the balance layer and clears the controllers' history.
+  void ResetBalance();
+  // Moves servo's offset in layer towards offset degrees, which is clamped to
+  // [-127, 127].
+  void SetLayerOffset(PoseLayer layer, int servo, int offset);
+  void ClearLayer(PoseLayer layer);
+  int layer_offset(PoseLayer layer, int servo) const {
+    return layers_[layer].target[servo];
+  }
+  // How fast offsets of layer follow their targets. 0 applies them at once.
+  void set_layer_ms_per_degree(PoseLayer layer, uint8_t ms) {
+    layers_[layer].ms_per_degree = ms;
+  }
 
  protected:
   void ResetAnimation();
+  bool StartSequence(int animation, const GaitTransform* transform,
+                     unsigned long millis_now);
+  void RunQueue(unsigned long millis_now);
+  void StartCommand(unsigned long millis_now);
+  void EndCommand(unsigned long millis_now);
+  void FinishCommand(unsigned long millis_now);
   void SetFrame(const int8_t* servo_values, unsigned long millis_now);
+  bool CycleEnds() const;
   void StartNextAnimationFrame(unsigned long millis_now);
+  bool NextSequenceFrame(int8_t* frame);
+  void BuildMappings();
+  // Writes logical_angle, in 1 / kAngleOne degrees, as a pulse width.
   void WriteServo(int servo, int logical_angle);
-  int ConvertToRealAngle(int servo, int angle);
-  void InterpolateToFrame(unsigned long millis_now, bool* done);
-  void ComputeBalancedFrame();
+  void InterpolateToFrame(unsigned long millis_now, uint16_t* moved,
+                          bool* done);
+  uint16_t StepLayers(unsigned long elapsed);
+  int ComposedPosition(int servo) const;
+  void PlanSegment();
+  void CapSegment(unsigned int ms);
+  unsigned int KeyframeMs(const int8_t* from, const int8_t* to) const;
+  void StartCadenceFrame(int8_t* next_frame, unsigned long millis_now);
+  void PlanSplineSegment();
+  unsigned int SplineSegmentMs(unsigned int max_delta) const;
+  bool PeekSequenceFrame(int8_t* frame) const;
+  bool cyclic() const;
+  bool StableFrames(uint8_t* frames) const;
+  uint8_t SequenceFrameCount() const;
+  uint16_t SequencePhase() const;
+  uint8_t NearestFrame() const;
+  void SeekEntryFrame(uint16_t phase);
+
+  // Motion of one servo of the base animation from its position when the
+  // segment started to its target, computed once per segment by PlanSegment.
+  // Angles are in 1 / kAngleOne degrees.
+  struct ServoSegment {
+    uint8_t servo;
+    int16_t start;
+    int16_t delta;
+    unsigned int ms;
+    uint32_t reciprocal;
+    // Velocities at either end for spline segments, see HermiteQ15.
+    int16_t tangent_start;
+    int16_t tangent_end;
+  };
 
   bool animating_ = false;
   unsigned long millis_last_ = 0;
   unsigned long millis_start_ = 0;
-  int8_t start_frame_[kServoCount];
-  int8_t target_unbalanced_frame_[kServoCount] = {0};
-  int8_t target_balanced_frame_[kServoCount];
+  int8_t target_frame_[kServoCount] = {0};
+  // Where the base animation has the servos, in 1 / kAngleOne degrees.
+  int16_t base_positions_[kServoCount];
+  // Only servos that move in the current segment, see PlanSegment.
+  ServoSegment segment_[kServoCount];
+  uint8_t segment_servos_ = 0;
+  unsigned int segment_ms_ = 0;
+  bool spline_segment_ = false;
+  // Whether the previous segment was part of the same spline, and where it
+  // started and how long it took.
+  bool spline_moving_ = false;
+  int16_t spline_previous_start_[kServoCount] = {0};
+  unsigned int spline_previous_ms_ = 0;
+  struct OffsetLayer {
+    int8_t target[kServoCount];
+    int16_t offset[kServoCount];  // In 1 / kAngleOne degrees.
+    uint8_t ms_per_degree;
+  };
+  OffsetLayer layers_[kLayerCount] = {};
+  // Whether any layer offset still differs from its target.
+  bool layers_moving_ = false;
   int animation_sequence_ = kAnimationSingleFrame;
   int animation_sequence_frame_number_ = 0;
+  FrameCursor cursor_;
+  GaitGenerator gait_;
+  struct AnimationCommand {
+    int8_t animation;
+    uint8_t repeats;
+    uint16_t hold_ms;
+  };
+  // Ring buffer of commands. The first one stays queued while it plays and
+  // holds.
+  AnimationCommand queue_[kAnimationQueueSize];
+  uint8_t queue_first_ = 0;
+  uint8_t queue_count_ = 0;
+  bool command_playing_ = false;
+  bool command_holding_ = false;
+  uint8_t cycles_left_ = 0;
+  // Frame whose arrival ends a cycle of a cyclic command: the one before the
+  // frame the command entered at.
+  uint8_t cycle_end_frame_ = 0;
+  unsigned long hold_start_ = 0;
+  AnimationObserver* observer_ = nullptr;
+  // Frame a gait stops at for StopAtStableFrame, and what plays next.
+  uint8_t stop_frame_ = kNoStableFrame;
+  int8_t stop_animation_ = 0;
 
   const EepromSettings* eeprom_settings_ = nullptr;
+  // Per servo constants WriteServo maps logical angles to pulse widths with,
+  // built from eeprom_settings_ by EepromSettingsChanged.
+  struct ServoMapping {
+    int16_t lower;  // Logical extents in 1 / kAngleOne degrees.
+    int16_t upper;
+    int16_t zero_us;  // Pulse width of logical angle 0.
+    int16_t us_per_step;  // Q12 pulse change per 1 / kAngleOne degrees.
+  };
+  ServoMapping mapping_[kServoCount];
   int ms_per_degree_ = kDefaultMsPerDegree;
-  int8_t current_positions_[kServoCount];
+  InterpolationMode interpolation_mode_ = kInterpolatePerServo;
+  unsigned int max_segment_ms_ = 0;
+  bool cadence_locked_ = false;
+  SwitchMode switch_mode_ = kSwitchFromStart;
+  unsigned int skipped_frames_ = 0;
+  unsigned long cadence_lag_ms_ = 0;
+  // Logical angles last written, base animation and layers combined, in
+  // 1 / kAngleOne degrees.
+  int16_t current_positions_[kServoCount];
+  // Pulse width each servo was last written, or kNoEmittedPulse to force the
+  // next write.
+  static const int16_t kNoEmittedPulse = -32768;
+  int16_t emitted_pulses_[kServoCount];
+  // 32 bits last over a month of 1kHz ticks.
+  uint32_t emitted_writes_[kServoCount] = {0};
+  uint32_t suppressed_writes_[kServoCount] = {0};
 
 #ifdef TESTING
  public:
 #endif  // TESTING
   static const int kDirectionMap[kServoCount];
-  Servo* servo_[kServoCount];
-  int pitch_ = 0;
-  int roll_ = 0;
+  ServoDriver driver_;
+  // Tilt the playing skill expects, which the balance leaves alone.
+  int8_t pitch_setpoint_ = 0;
+  int8_t roll_setpoint_ = 0;
+  unsigned long balance_millis_ = 0;  // Time of the last tilt sample.
+  BalanceController pitch_balance_;
+  BalanceController roll_balance_;
 };
 
 #endif  // _SERVO_ANIMATOR_H
\ No newline at end of file
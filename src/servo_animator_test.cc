@@ -2,16 +2,32 @@
 
 #include "eeprom_settings.h"
 
+#include <algorithm>
+#include <vector>
 #include <gtest/gtest.h>
 
+// Instinct.h names clash with POSIX functions such as sleep(), and with
+// skills_test's copy.
+namespace animator_instinct {
+#define PROGMEM
+#include "Instinct.h"
+}  // namespace animator_instinct
+
+// Nearest whole real angle of the pulse the servo is driven with.
+static int Degrees(const ServoAnimator& animator, int servo) {
+  const int kRange = kMaxPulseUs - kMinPulseUs;
+  return ((animator.driver_.pulse_us(servo) - kMinPulseUs) * 180 +
+          kRange / 2) / kRange;
+}
+
 class ServoAnimatorTest : public testing::Test {
  protected:
   ServoAnimatorTest() {}
 
   void SetUp() override {
     animator_.Initialize();
-    animator_.SetEepromSettings(&settings_);
-    const int8_t* rest_frame = animator_.GetFrame(kAnimationRest, 0);
+    int8_t rest_frame[kServoCount];
+    ASSERT_TRUE(animator_.GetFrame(kAnimationRest, 0, rest_frame));
 
     for (int i = 0; i < kServoCount; ++i) {
       rest_positions_[i] = 90 + rest_frame[i] * animator_.kDirectionMap[i];
@@ -19,11 +35,23 @@ class ServoAnimatorTest : public testing::Test {
       settings_.servo_upper_extents[i] = 90;
       settings_.servo_lower_extents[i] = -90;
     }
+    SetDefaultBalanceSettings(&settings_);
+    animator_.SetEepromSettings(&settings_);
   }
 
   void TestAnimate(int servo, int* test_ms, int* expected_angle, int count);
+  int KeyframeMotion(InterpolationMode mode);
+  unsigned long TransitionMs(int from, int to, unsigned long play_ms,
+                             SwitchMode mode);
+
+  const int8_t* Frame(int animation, int number) {
+    if (!animator_.GetFrame(animation, number, frame_))
+      return nullptr;
+    return frame_;
+  }
 
   ServoAnimator animator_;
+  int8_t frame_[kServoCount];
   int rest_positions_[kServoCount];
   EepromSettings settings_;
 };
@@ -33,34 +61,33 @@ TEST_F(ServoAnimatorTest, Initialize) {
 }
 
 TEST_F(ServoAnimatorTest, GetFrameForCalibrationPose) {
-  const int8_t* frame =
-    animator_.GetFrame(kAnimationCalibrationPose, 0);
+  int8_t frame[kServoCount];
+  ASSERT_TRUE(animator_.GetFrame(kAnimationCalibrationPose, 0, frame));
   for (int i = 0; i < kServoCount; ++i)
     EXPECT_EQ(0, frame[i]);
 }
 
 TEST_F(ServoAnimatorTest, GetFrameForActualFrameAnimation) {
-  const int8_t* frame =
-    animator_.GetFrame(kAnimationFistBump, 0);
-  ASSERT_NE(nullptr, frame);
+  int8_t frame[kServoCount];
+  int8_t second_frame[kServoCount];
+  ASSERT_TRUE(animator_.GetFrame(kAnimationFistBump, 0, frame));
+  ASSERT_TRUE(animator_.GetFrame(kAnimationFistBump, 1, second_frame));
+  // Decoding the second frame leaves the first one alone.
   EXPECT_EQ(-50, frame[kServoHead]);
   EXPECT_EQ(-80, frame[kServoRightBackShoulder]);
-  frame = animator_.GetFrame(kAnimationFistBump, 1);
-  ASSERT_NE(nullptr, frame);
-  EXPECT_EQ(-20, frame[kServoHead]);
-  EXPECT_EQ(-80, frame[kServoRightBackShoulder]);
-  frame = animator_.GetFrame(kAnimationFistBump, 2);
-  EXPECT_EQ(nullptr, frame);
+  EXPECT_EQ(-20, second_frame[kServoHead]);
+  EXPECT_EQ(-80, second_frame[kServoRightBackShoulder]);
+  EXPECT_FALSE(animator_.GetFrame(kAnimationFistBump, 2, frame));
 }
 
 TEST_F(ServoAnimatorTest, AttachAttachesAndSetsToRestingPosition) {
   for (int i = 0; i < kServoCount; ++i)
-    EXPECT_FALSE(animator_.servo_[i]->attached);
+    EXPECT_FALSE(animator_.driver_.attached(i));
   animator_.Attach();
 
   for (int i = 0; i < kServoCount; ++i) {
-    EXPECT_TRUE(animator_.servo_[i]->attached);
-    EXPECT_EQ(rest_positions_[i], animator_.servo_[i]->value);
+    EXPECT_TRUE(animator_.driver_.attached(i));
+    EXPECT_EQ(rest_positions_[i], Degrees(animator_, i));
   }
 }
 
@@ -68,20 +95,19 @@ TEST_F(ServoAnimatorTest, DetachDetaches) {
   animator_.Attach();
   animator_.Detach();
   for (int i = 0; i < kServoCount; ++i)
-    EXPECT_FALSE(animator_.servo_[i]->attached);
+    EXPECT_FALSE(animator_.driver_.attached(i));
 }
 
 TEST_F(ServoAnimatorTest, StartFrameToCalibrationAndAnimateConverges) {
-  const int8_t* frame =
-    animator_.GetFrame(kAnimationCalibrationPose, 0);
+  const int8_t* frame = Frame(kAnimationCalibrationPose, 0);
   animator_.Attach();
   // We tested above that Attach is now at resting position.
 
   animator_.StartFrame(frame, 0);
 
   for (int i = 0; i < kServoCount; ++i) {
-    EXPECT_TRUE(animator_.servo_[i]->attached);
-    EXPECT_EQ(rest_positions_[i], animator_.servo_[i]->value);
+    EXPECT_TRUE(animator_.driver_.attached(i));
+    EXPECT_EQ(rest_positions_[i], Degrees(animator_, i));
   }
 
   EXPECT_TRUE(animator_.animating());
@@ -91,8 +117,8 @@ TEST_F(ServoAnimatorTest, StartFrameToCalibrationAndAnimateConverges) {
   EXPECT_FALSE(animator_.animating());
 
   for (int i = 0; i < kServoCount; ++i) {
-    EXPECT_TRUE(animator_.servo_[i]->attached);
-    EXPECT_EQ(90, animator_.servo_[i]->value);
+    EXPECT_TRUE(animator_.driver_.attached(i));
+    EXPECT_EQ(90, Degrees(animator_, i));
   }
 }
 
@@ -100,13 +126,13 @@ TEST_F(ServoAnimatorTest, StartFrameToCalibrationWithZeroOffsets) {
   settings_.servo_zero_offset[kServoHead] = -5;
   settings_.servo_zero_offset[kServoLeftFrontShoulder] = 7;
   settings_.servo_zero_offset[kServoRightFrontShoulder] = 7;
-   const int8_t* frame =
-    animator_.GetFrame(kAnimationCalibrationPose, 0); 
+  animator_.EepromSettingsChanged();
+  const int8_t* frame = Frame(kAnimationCalibrationPose, 0);
   animator_.Attach();
   animator_.StartFrame(frame, 1);
   animator_.Animate(10000);
   for (int i = 0; i < kServoCount; ++i) {
-    EXPECT_TRUE(animator_.servo_[i]->attached);
+    EXPECT_TRUE(animator_.driver_.attached(i));
     int expected = 90;
     switch (i) {
      case kServoHead:
@@ -121,14 +147,14 @@ TEST_F(ServoAnimatorTest, StartFrameToCalibrationWithZeroOffsets) {
       expected = 83;
       break;
     }
-    EXPECT_EQ(expected, animator_.servo_[i]->value) << "servo " << i;
+    EXPECT_EQ(expected, Degrees(animator_, i)) << "servo " << i;
   }
 }
 
 void ServoAnimatorTest::TestAnimate(int servo, int* test_ms, int* expected_angle, int count) {
   for (int i = 0; i < count; ++i) {
     animator_.Animate(test_ms[i]);
-    ASSERT_EQ(expected_angle[i], animator_.servo_[servo]->value) << "Test at " << test_ms[i] << "ms";
+    ASSERT_EQ(expected_angle[i], Degrees(animator_, servo)) << "Test at " << test_ms[i] << "ms";
     ASSERT_EQ(i != count - 1, animator_.animating()) << "Test at " << test_ms[i] << "ms";
   }
 }
@@ -137,7 +163,7 @@ TEST_F(ServoAnimatorTest, FrameInterpolationIsSmooth) {
   animator_.Attach();
 
   {
-    animator_.StartFrame(animator_.GetFrame(kAnimationCalibrationPose, 0), 0);
+    animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
     // From Rest to Calibrate Pose, the biggest change is shoulder rotation
     // from 60 to 0 degrees. With min_ms_per_angle_ of 1, this transition
     // should take 60 milliseconds to complete. Using cosine for smoothing, we
@@ -153,7 +179,7 @@ TEST_F(ServoAnimatorTest, FrameInterpolationIsSmooth) {
   {
     // Move to balance will only take 30ms because biggest angle motion is
     // 30 degrees.
-    animator_.StartFrame(animator_.GetFrame(kAnimationBalance, 0), 80);
+    animator_.StartFrame(Frame(kAnimationBalance, 0), 80);
     int test_ms[] =        {  81,  87,  95, 102, 109, 110 };
     int expected_angle[] = {  90,  86,  75,  65,  60,  60 };
 
@@ -163,7 +189,7 @@ TEST_F(ServoAnimatorTest, FrameInterpolationIsSmooth) {
 
   { // Animate back to rest. Track one of the negative direction motions.
     // Move from balance to rest moves knee servos 75 degrees (max movement).
-    animator_.StartFrame(animator_.GetFrame(kAnimationRest, 0), 200);
+    animator_.StartFrame(Frame(kAnimationRest, 0), 200);
     int test_ms[] =        { 201, 219, 238, 256, 274, 275 };
     int expected_angle[] = { 120, 109,  82,  56,  45,  45 };
 
@@ -175,9 +201,9 @@ TEST_F(ServoAnimatorTest, FrameInterpolationIsSmooth) {
 TEST_F(ServoAnimatorTest, AnimationCalibrationPoseCompletesAndStaysAttached) {
   animator_.StartAnimation(kAnimationCalibrationPose, 0);
   animator_.Animate(10000);
-  EXPECT_EQ(90, animator_.servo_[kServoHead]->value);
+  EXPECT_EQ(90, Degrees(animator_, kServoHead));
   EXPECT_FALSE(animator_.animating());
-  EXPECT_TRUE(animator_.servo_[kServoHead]->attached);
+  EXPECT_TRUE(animator_.driver_.attached(kServoHead));
 }
 
 TEST_F(ServoAnimatorTest, AnimationRestCompletesAndDetaches) {
@@ -185,7 +211,150 @@ TEST_F(ServoAnimatorTest, AnimationRestCompletesAndDetaches) {
 
   animator_.Animate(10000);
   EXPECT_FALSE(animator_.animating());
-  EXPECT_FALSE(animator_.servo_[kServoHead]->attached);
+  EXPECT_FALSE(animator_.driver_.attached(kServoHead));
+}
+
+class RecordingObserver : public AnimationObserver {
+ public:
+  void OnAnimationDone(int animation) override {
+    done_.push_back(animation);
+  }
+
+  std::vector<int> done_;
+};
+
+TEST_F(ServoAnimatorTest, SequenceCompletionIsObserved) {
+  RecordingObserver observer;
+  animator_.set_observer(&observer);
+  animator_.StartAnimation(kAnimationRest, 0);
+  animator_.Animate(10000);
+  EXPECT_EQ(std::vector<int>({ kAnimationRest }), observer.done_);
+  EXPECT_FALSE(animator_.driver_.attached(kServoHead));
+
+  // Looping sequences and direct frames never report done.
+  animator_.StartAnimation(kAnimationFistBump, 10000);
+  for (unsigned long millis_now = 10000; millis_now < 20000; millis_now += 10)
+    animator_.Animate(millis_now);
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 20000);
+  animator_.Animate(30000);
+  EXPECT_EQ(1u, observer.done_.size());
+}
+
+TEST_F(ServoAnimatorTest, QueuedCommandsRepeatHoldAndChain) {
+  RecordingObserver observer;
+  animator_.set_observer(&observer);
+  animator_.Attach();
+  animator_.set_ms_per_degree(4);
+  EXPECT_TRUE(animator_.QueueAnimation(kAnimationFistBump, 2, 0));
+  EXPECT_TRUE(animator_.QueueAnimation(kAnimationCalibrationPose, 1, 500));
+  EXPECT_TRUE(animator_.QueueAnimation(kAnimationRest, 1, 0));
+  EXPECT_EQ(3, animator_.queued_commands());
+
+  unsigned long millis_now = 0;
+  int bumps = 0;
+  int last_frame = -1;
+  unsigned long posed_ms = 0;
+  unsigned long calibration_done_ms = 0;
+  while (animator_.queued_commands() > 0 && millis_now < 60000) {
+    animator_.Animate(++millis_now);
+    if (animator_.animation_sequence() == kAnimationFistBump) {
+      int frame = animator_.animation_sequence_frame_number();
+      if (frame == 1 && last_frame != 1)
+        ++bumps;
+      last_frame = frame;
+    }
+    if (animator_.animation_sequence() == kAnimationCalibrationPose &&
+        !animator_.animating() && posed_ms == 0)
+      posed_ms = millis_now;
+    if (observer.done_.size() == 2 && calibration_done_ms == 0)
+      calibration_done_ms = millis_now;
+  }
+  EXPECT_EQ(2, bumps);
+  EXPECT_EQ(std::vector<int>({ kAnimationFistBump, kAnimationCalibrationPose,
+                               kAnimationRest }), observer.done_);
+  EXPECT_EQ(500u, calibration_done_ms - posed_ms);
+  EXPECT_FALSE(animator_.driver_.attached(kServoHead));
+}
+
+TEST_F(ServoAnimatorTest, RepeatUntilNextLoopsUntilACommandFollows) {
+  RecordingObserver observer;
+  animator_.set_observer(&observer);
+  animator_.QueueAnimation(kAnimationFistBump, kRepeatUntilNext, 0);
+  unsigned long millis_now = 0;
+  for (; millis_now < 5000; millis_now += 10)
+    animator_.Animate(millis_now);
+  EXPECT_EQ(kAnimationFistBump, animator_.animation_sequence());
+  EXPECT_TRUE(observer.done_.empty());
+
+  // The cycle in progress finishes first.
+  animator_.QueueAnimation(kAnimationBalance, 1, 0);
+  while (animator_.animation_sequence() == kAnimationFistBump &&
+         millis_now < 10000) {
+    EXPECT_TRUE(animator_.animating());
+    animator_.Animate(millis_now += 10);
+  }
+  EXPECT_EQ(kAnimationBalance, animator_.animation_sequence());
+  EXPECT_EQ(std::vector<int>({ kAnimationFistBump }), observer.done_);
+}
+
+// Commands queued while a gait plays enter at its nearest frame, and still
+// play whole cycles from there.
+TEST_F(ServoAnimatorTest, QueuedRepeatsAfterAGaitPlayWholeCycles) {
+  animator_.set_switch_mode(kSwitchNearestPose);
+  animator_.set_cadence_locked(true);
+  const int kCommands[][2] = { { kAnimationFistBump, 3 }, { kAnimationTr, 2 } };
+  for (const int* command : kCommands) {
+    unsigned long millis_now = 0;
+    animator_.StartAnimation(kAnimationWalk, millis_now);
+    for (int i = 0; i < 777; ++i)
+      animator_.Animate(++millis_now);
+    animator_.QueueAnimation(command[0], command[1], 0);
+    animator_.QueueAnimation(kAnimationBalance, 1, 0);
+    animator_.Animate(++millis_now);
+    ASSERT_EQ(command[0], animator_.animation_sequence());
+    int entry = animator_.animation_sequence_frame_number();
+    int frames = 1;
+    int last_frame = entry;
+    while (animator_.animation_sequence() == command[0] &&
+           millis_now < 60000) {
+      animator_.Animate(++millis_now);
+      int frame = animator_.animation_sequence_frame_number();
+      if (animator_.animation_sequence() == command[0] && frame != last_frame)
+        ++frames;
+      last_frame = frame;
+    }
+    SkillInfo info;
+    ASSERT_TRUE(GetSkillInfo(command[0], &info));
+    EXPECT_EQ(command[1] * info.frame_count, frames)
+        << "animation " << command[0] << " entered at " << entry;
+    EXPECT_EQ(kAnimationBalance, animator_.animation_sequence());
+  }
+}
+
+TEST_F(ServoAnimatorTest, QueueIsBoundedAndCleared) {
+  for (int i = 0; i < kAnimationQueueSize; ++i)
+    EXPECT_TRUE(animator_.QueueAnimation(kAnimationSit, 1, 0));
+  EXPECT_FALSE(animator_.QueueAnimation(kAnimationSit, 1, 0));
+  animator_.ClearQueue();
+  EXPECT_EQ(0, animator_.queued_commands());
+
+  // Starting an animation directly drops the queue.
+  animator_.QueueAnimation(kAnimationSit, 1, 0);
+  animator_.Animate(1);
+  EXPECT_EQ(kAnimationSit, animator_.animation_sequence());
+  animator_.QueueAnimation(kAnimationStretch, 1, 0);
+  animator_.StartAnimation(kAnimationBalance, 2);
+  EXPECT_EQ(0, animator_.queued_commands());
+  animator_.Animate(10000);
+  EXPECT_EQ(kAnimationBalance, animator_.animation_sequence());
+
+  // Unknown animations finish at once.
+  RecordingObserver observer;
+  animator_.set_observer(&observer);
+  animator_.QueueAnimation(100, 1, 0);
+  animator_.Animate(10001);
+  EXPECT_EQ(0, animator_.queued_commands());
+  EXPECT_EQ(std::vector<int>({ 100 }), observer.done_);
 }
 
 TEST_F(ServoAnimatorTest, AnimationWalkLoops) {
@@ -195,7 +364,7 @@ TEST_F(ServoAnimatorTest, AnimationWalkLoops) {
   for (int i = 0; i < 600; ++i) {
     millis_now += 1000;
     animator_.Animate(millis_now);
-    ASSERT_TRUE(animator_.servo_[kServoHead]->attached);
+    ASSERT_TRUE(animator_.driver_.attached(kServoHead));
     ASSERT_TRUE(animator_.animating());
     int next_frame = (i + 1) % 43;
     ASSERT_EQ(next_frame, animator_.animation_sequence_frame_number());
@@ -203,27 +372,155 @@ TEST_F(ServoAnimatorTest, AnimationWalkLoops) {
 }
 
 TEST_F(ServoAnimatorTest, AnimationCalibrationPoseBalances) {
+  const BalanceGains kProportional = { 16, 0, 0 };
+  settings_.pitch_gains = kProportional;
+  settings_.roll_gains = kProportional;
   animator_.StartAnimation(kAnimationCalibrationPose, 0);
 
-  animator_.HandlePitchRoll(-10, 0, 0);
+  animator_.HandlePitchRoll(-10 * kAngleOne, 0, 0);
   animator_.Animate(10000);
-  EXPECT_EQ(80, animator_.servo_[kServoHead]->value);
-  EXPECT_EQ(90, animator_.servo_[kServoNeck]->value);
+  EXPECT_EQ(80, Degrees(animator_, kServoHead));
+  EXPECT_EQ(90, Degrees(animator_, kServoNeck));
 
-  animator_.HandlePitchRoll(0, 20, 10000);
+  animator_.HandlePitchRoll(0, 20 * kAngleOne, 10000);
   animator_.Animate(20000);
-  EXPECT_EQ(90, animator_.servo_[kServoHead]->value);
-  EXPECT_EQ(110, animator_.servo_[kServoNeck]->value);
+  EXPECT_EQ(90, Degrees(animator_, kServoHead));
+  EXPECT_EQ(110, Degrees(animator_, kServoNeck));
 
   animator_.HandlePitchRoll(0, 0, 20000);
   animator_.Animate(30000);
-  EXPECT_EQ(90, animator_.servo_[kServoHead]->value);
-  EXPECT_EQ(90, animator_.servo_[kServoNeck]->value);
+  EXPECT_EQ(90, Degrees(animator_, kServoHead));
+  EXPECT_EQ(90, Degrees(animator_, kServoNeck));
+}
+
+TEST_F(ServoAnimatorTest, BalanceIntegratesAPersistentTilt) {
+  animator_.Attach();
+  for (unsigned long millis_now = 10; millis_now <= 1000; millis_now += 10) {
+    animator_.HandlePitchRoll(-5 * kAngleOne, 0, millis_now);
+    animator_.Animate(millis_now);
+  }
+  // The default gains add 4 times the tilt per second to the correction.
+  EXPECT_NEAR(-25, animator_.layer_offset(kLayerBalance, kServoHead), 1);
+  EXPECT_EQ(rest_positions_[kServoHead] - 25, Degrees(animator_, kServoHead));
+
+  // Picking the cat up resets the balance.
+  animator_.HandlePitchRoll(120 * kAngleOne, 0, 1010);
+  animator_.Animate(2000);
+  for (int i = 0; i < kServoCount; ++i)
+    EXPECT_EQ(0, animator_.layer_offset(kLayerBalance, i)) << "servo " << i;
+  EXPECT_EQ(rest_positions_[kServoHead], Degrees(animator_, kServoHead));
+}
+
+TEST_F(ServoAnimatorTest, BalanceSeesTiltsBetweenWholeDegrees) {
+  animator_.Attach();
+  // 2.5 degrees, which whole degrees would round to 2 or 3, gets half the
+  // correction of 5 degrees.
+  for (unsigned long millis_now = 10; millis_now <= 1000; millis_now += 10) {
+    animator_.HandlePitchRoll(-5 * kAngleOne / 2, 0, millis_now);
+    animator_.Animate(millis_now);
+  }
+  EXPECT_NEAR(-12.5, animator_.layer_offset(kLayerBalance, kServoHead), 1);
+}
+
+TEST_F(ServoAnimatorTest, BalanceHoldsTheTiltOfASittingPose) {
+  SkillInfo info;
+  ASSERT_TRUE(GetSkillInfo(kAnimationSit, &info));
+  ASSERT_EQ(30, info.pitch);
+  animator_.Attach();
+  animator_.StartAnimation(kAnimationSit, 0);
+  // Sitting tilts the body as sit expects, which leaves the pose alone
+  // however long it is held.
+  unsigned long millis_now = 0;
+  for (int i = 0; i < 1000; ++i) {
+    millis_now += 10;
+    animator_.HandlePitchRoll(info.pitch * kAngleOne, info.roll * kAngleOne,
+                              millis_now);
+    animator_.Animate(millis_now);
+  }
+  for (int i = 0; i < kServoCount; ++i)
+    EXPECT_EQ(0, animator_.layer_offset(kLayerBalance, i)) << "servo " << i;
+
+  // Only a tilt past it is balanced.
+  for (int i = 0; i < 100; ++i) {
+    millis_now += 10;
+    animator_.HandlePitchRoll((info.pitch - 5) * kAngleOne,
+                              info.roll * kAngleOne, millis_now);
+    animator_.Animate(millis_now);
+  }
+  EXPECT_NEAR(-25, animator_.layer_offset(kLayerBalance, kServoHead), 1);
+}
+
+TEST_F(ServoAnimatorTest, SmallTiltsBalanceWithoutRestartingTheSegment) {
+  const BalanceGains kProportional = { 16, 0, 0 };
+  settings_.pitch_gains = kProportional;
+  ServoAnimator reference;
+  reference.Initialize();
+  reference.SetEepromSettings(&settings_);
+  animator_.Attach();
+  reference.Attach();
+  animator_.StartAnimation(kAnimationWalk, 0);
+  reference.StartAnimation(kAnimationWalk, 0);
+  for (unsigned long millis_now = 1; millis_now <= 20; ++millis_now) {
+    animator_.Animate(millis_now);
+    reference.Animate(millis_now);
+  }
+
+  // A 4 degree tilt fed at 10ms steps moves the head while the legs keep
+  // following the same segments as without it.
+  for (unsigned long millis_now = 21; millis_now <= 200; ++millis_now) {
+    if (millis_now % 10 == 0)
+      animator_.HandlePitchRoll(-4 * kAngleOne, 0, millis_now);
+    animator_.Animate(millis_now);
+    reference.Animate(millis_now);
+    ASSERT_EQ(reference.animation_sequence_frame_number(),
+              animator_.animation_sequence_frame_number());
+  }
+  EXPECT_EQ(Degrees(reference, kServoHead) - 4, Degrees(animator_, kServoHead));
+  int leg_offsets[] = { 4, 4, 4, 4, -5, -5, -5, -5 };
+  for (int i = kServoLeftFrontShoulder; i < kServoCount; ++i) {
+    EXPECT_NEAR(leg_offsets[i - kServoLeftFrontShoulder] *
+                animator_.kDirectionMap[i],
+                Degrees(animator_, i) - Degrees(reference, i), 1)
+        << "servo " << i;
+  }
+}
+
+TEST_F(ServoAnimatorTest, LayersMoveAtTheirOwnRates) {
+  animator_.Attach();
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
+  animator_.Animate(10000);
+  ASSERT_FALSE(animator_.animating());
+
+  // Trims apply on the next tick.
+  animator_.SetLayerOffset(kLayerTrim, kServoTail, 5);
+  animator_.Animate(10001);
+  EXPECT_EQ(90 - 5, Degrees(animator_, kServoTail));
+  EXPECT_FALSE(animator_.animating());
+
+  // Glances take 10ms per degree, added to the trims.
+  animator_.SetLayerOffset(kLayerTrim, kServoHead, 5);
+  animator_.SetLayerOffset(kLayerLookAround, kServoHead, 20);
+  animator_.Animate(10101);
+  EXPECT_EQ(90 + 5 + 10, Degrees(animator_, kServoHead));
+  animator_.Animate(10201);
+  EXPECT_EQ(90 + 5 + 20, Degrees(animator_, kServoHead));
+  EXPECT_EQ(20, animator_.layer_offset(kLayerLookAround, kServoHead));
+
+  // A new pose keeps the layers, and clearing one eases it back.
+  animator_.StartFrame(Frame(kAnimationRest, 0), 20000);
+  animator_.Animate(30000);
+  EXPECT_EQ(rest_positions_[kServoHead] + 25, Degrees(animator_, kServoHead));
+  animator_.ClearLayer(kLayerLookAround);
+  animator_.set_layer_ms_per_degree(kLayerLookAround, 0);
+  animator_.Animate(30001);
+  EXPECT_EQ(rest_positions_[kServoHead] + 5, Degrees(animator_, kServoHead));
+  EXPECT_EQ(rest_positions_[kServoTail] - 5, Degrees(animator_, kServoTail));
 }
 
 TEST_F(ServoAnimatorTest, ExtentsAreRespected) {
   settings_.servo_lower_extents[kServoHead] = -30;
   settings_.servo_upper_extents[kServoLeftFrontShoulder] = 40;
+  animator_.EepromSettingsChanged();
   animator_.Attach();
 
   int actual_rest_positions[kServoCount];
@@ -232,7 +529,575 @@ TEST_F(ServoAnimatorTest, ExtentsAreRespected) {
   actual_rest_positions[kServoLeftFrontShoulder] = 130;
 
   for (int i = 0; i < kServoCount; ++i) {
-    EXPECT_TRUE(animator_.servo_[i]->attached);
-    EXPECT_EQ(actual_rest_positions[i], animator_.servo_[i]->value);
+    EXPECT_TRUE(animator_.driver_.attached(i));
+    EXPECT_EQ(actual_rest_positions[i], Degrees(animator_, i));
+  }
+}
+
+TEST_F(ServoAnimatorTest, ServosAtTargetAreNotWritten) {
+  int8_t frame[kServoCount];
+  ASSERT_TRUE(animator_.GetFrame(kAnimationRest, 0, frame));
+  frame[kServoHead] = 0;
+  animator_.Attach();
+  animator_.ResetWriteStats();
+
+  animator_.StartFrame(frame, 0);
+  animator_.Animate(10);
+  EXPECT_TRUE(animator_.animating());
+  animator_.Animate(10000);
+  EXPECT_FALSE(animator_.animating());
+
+  EXPECT_EQ(90, Degrees(animator_, kServoHead));
+  for (int i = kServoNeck; i < kServoCount; ++i) {
+    EXPECT_EQ(0u, animator_.emitted_writes(i) + animator_.suppressed_writes(i))
+        << "servo " << i;
+  }
+}
+
+TEST_F(ServoAnimatorTest, GaitLoopsAndFollowsParameterChanges) {
+  unsigned long millis_now = 0;
+  animator_.StartAnimation(kAnimationGait, millis_now);
+  int frames = animator_.gait()->frames_per_cycle();
+
+  for (int i = 0; i < 3 * frames; ++i) {
+    millis_now += 1000;
+    animator_.Animate(millis_now);
+    ASSERT_TRUE(animator_.animating());
+    ASSERT_EQ((i + 1) % frames, animator_.animation_sequence_frame_number());
+  }
+
+  // A zero stride stands still in the neutral pose after the next frame.
+  animator_.gait()->set_stride(0);
+  millis_now += 1000;
+  animator_.Animate(millis_now);
+  millis_now += 1000;
+  animator_.Animate(millis_now);
+  int8_t frame[kServoCount];
+  animator_.gait()->ComputeFrame(0, frame);
+  for (int i = 0; i < kServoCount; ++i) {
+    EXPECT_EQ(90 + frame[i] * animator_.kDirectionMap[i],
+              Degrees(animator_, i)) << "servo " << i;
+  }
+}
+
+// cr played through crR's transform lands within 3 degrees of the crR
+// frames that Instinct.h has and skill_frames.h leaves out.
+TEST_F(ServoAnimatorTest, TransformedAnimationTurnsAStraightGait) {
+  SkillVariant variant;
+  ASSERT_TRUE(GetSkillVariant(kAnimationCrawlRight, &variant));
+  ASSERT_EQ(kAnimationCrawl, variant.base);
+  const char* instinct = animator_instinct::crR;
+  const int kWalkingServos[] = {
+    kServoLeftFrontShoulder, kServoRightFrontShoulder, kServoRightBackShoulder,
+    kServoLeftBackShoulder, kServoLeftFrontKnee, kServoRightFrontKnee,
+    kServoRightBackKnee, kServoLeftBackKnee
+  };
+  int count = instinct[0];
+
+  animator_.StartTransformedAnimation(kAnimationCrawl, variant.transform, 0);
+  unsigned long millis_now = 0;
+  for (int number = 0; number < 2 * count; ++number) {
+    millis_now += 1000;
+    animator_.Animate(millis_now);
+    const char* frame = instinct + 3 + 8 * (number % count);
+    for (int i = 0; i < 8; ++i) {
+      int servo = kWalkingServos[i];
+      int expected = 90 + frame[i] * animator_.kDirectionMap[servo];
+      EXPECT_NEAR(expected, Degrees(animator_, servo), 3)
+          << "frame " << number % count << " servo " << servo;
+    }
+  }
+}
+
+TEST_F(ServoAnimatorTest, SynchronizedServosArriveTogether) {
+  // From Rest to the calibration pose the tail moves 45 degrees and the
+  // shoulders 60, so on its own the tail arrives 15ms early.
+  animator_.Attach();
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
+  animator_.Animate(45);
+  EXPECT_EQ(90, Degrees(animator_, kServoTail));
+
+  animator_.StartFrame(Frame(kAnimationRest, 0), 100);
+  animator_.Animate(200);
+  animator_.set_interpolation_mode(kInterpolateSynchronized);
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 300);
+  animator_.Animate(345);
+  EXPECT_EQ(97, Degrees(animator_, kServoTail));
+  EXPECT_TRUE(animator_.animating());
+  animator_.Animate(360);
+  EXPECT_EQ(90, Degrees(animator_, kServoTail));
+  EXPECT_EQ(90, Degrees(animator_, kServoLeftFrontShoulder));
+  EXPECT_FALSE(animator_.animating());
+}
+
+TEST_F(ServoAnimatorTest, MaxSegmentMsCapsSegments) {
+  animator_.Attach();
+  animator_.set_max_segment_ms(20);
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
+  animator_.Animate(10);
+  EXPECT_EQ(120, Degrees(animator_, kServoLeftFrontShoulder));
+  EXPECT_TRUE(animator_.animating());
+  animator_.Animate(20);
+  EXPECT_EQ(90, Degrees(animator_, kServoLeftFrontShoulder));
+  EXPECT_EQ(90, Degrees(animator_, kServoTail));
+  EXPECT_FALSE(animator_.animating());
+}
+
+// Returns the ms one full cycle of a looping animation takes, measured from
+// the second time its first frame starts so that the move from the starting
+// pose is left out.
+static unsigned long MeasureCycleMs(ServoAnimator* animator, int animation) {
+  unsigned long millis_now = 0;
+  animator->StartAnimation(animation, millis_now);
+  unsigned long cycle_start = 0;
+  int starts = 0;
+  int last_frame = animator->animation_sequence_frame_number();
+  while (millis_now < 1000000) {
+    animator->Animate(++millis_now);
+    int frame = animator->animation_sequence_frame_number();
+    if (frame == 0 && last_frame != 0) {
+      if (++starts == 2)
+        return millis_now - cycle_start;
+      cycle_start = millis_now;
+    }
+    last_frame = frame;
+  }
+  return 0;
+}
+
+TEST_F(ServoAnimatorTest, GaitCycleBenchmark) {
+  const int kGaits[] = {
+    kAnimationWalk, kAnimationWalkLeft, kAnimationTr, kAnimationCrawl,
+    kAnimationBackUp, kAnimationGait
+  };
+  // The remote control's default speed.
+  const int kMsPerDegree = 4;
+  const unsigned int kCapMs = 20;
+  animator_.Attach();
+  animator_.set_ms_per_degree(kMsPerDegree);
+  for (int gait : kGaits) {
+    animator_.set_max_segment_ms(0);
+    animator_.set_interpolation_mode(kInterpolatePerServo);
+    unsigned long per_servo = MeasureCycleMs(&animator_, gait);
+    animator_.set_interpolation_mode(kInterpolateSynchronized);
+    unsigned long synchronized = MeasureCycleMs(&animator_, gait);
+    animator_.set_max_segment_ms(kCapMs);
+    unsigned long capped = MeasureCycleMs(&animator_, gait);
+    animator_.set_max_segment_ms(0);
+    animator_.set_interpolation_mode(kInterpolateSpline);
+    unsigned long spline = MeasureCycleMs(&animator_, gait);
+    // Sharing the slowest servo's time never changes how long a segment
+    // takes; only the cap and the spline shorten it. The spline's segments
+    // take 2/PI (41722 / 2^16) of the synchronized time, rounded down, which
+    // is where all of its speed-up comes from.
+    unsigned long compressed = (synchronized * 41722) >> 16;
+    EXPECT_EQ(per_servo, synchronized) << "gait " << gait;
+    EXPECT_LE(capped, synchronized) << "gait " << gait;
+    EXPECT_LE(spline, compressed) << "gait " << gait;
+    EXPECT_GT(spline, compressed * 95 / 100) << "gait " << gait;
+    printf("Gait %d cycle at %dms/deg: per servo=%lums, synchronized=%lums, "
+           "capped at %ums=%lums, spline=%lums (2/PI of synchronized=%lums)\n",
+           gait, kMsPerDegree, per_servo, synchronized, kCapMs, capped, spline,
+           compressed);
+  }
+}
+
+TEST_F(ServoAnimatorTest, SwitchingEntersAtTheNearestPoseOrPhase) {
+  animator_.Attach();
+  animator_.set_ms_per_degree(4);
+  unsigned long millis_now = 0;
+  animator_.StartAnimation(kAnimationWalk, millis_now);
+  while (animator_.animation_sequence_frame_number() != 10)
+    animator_.Animate(++millis_now);
+  // Just past frame 9, where the servos are.
+  animator_.set_switch_mode(kSwitchNearestPose);
+  animator_.StartAnimation(kAnimationWalk, millis_now);
+  EXPECT_EQ(9, animator_.animation_sequence_frame_number());
+
+  // Frame 9 of wkF's 43 is frame 6 of trF's 30.
+  animator_.set_switch_mode(kSwitchMatchPhase);
+  animator_.StartAnimation(kAnimationTr, millis_now);
+  EXPECT_EQ(6, animator_.animation_sequence_frame_number());
+  animator_.set_switch_mode(kSwitchFromStart);
+  animator_.StartAnimation(kAnimationWalk, millis_now);
+  EXPECT_EQ(0, animator_.animation_sequence_frame_number());
+
+  // Sequences started from a pose begin at their first frame.
+  animator_.set_switch_mode(kSwitchNearestPose);
+  animator_.StartAnimation(kAnimationCalibrationPose, millis_now);
+  animator_.Animate(millis_now + 10000);
+  animator_.StartAnimation(kAnimationTr, millis_now + 10000);
+  EXPECT_EQ(0, animator_.animation_sequence_frame_number());
+}
+
+// Plays from for play_ms, switches to to with mode and returns the ms the
+// servos take to reach the first frame of to.
+unsigned long ServoAnimatorTest::TransitionMs(int from, int to,
+                                              unsigned long play_ms,
+                                              SwitchMode mode) {
+  ServoAnimator animator;
+  animator.Initialize();
+  animator.SetEepromSettings(&settings_);
+  animator.Attach();
+  animator.set_ms_per_degree(4);
+  animator.set_switch_mode(mode);
+  unsigned long millis_now = 0;
+  animator.StartAnimation(from, millis_now);
+  while (millis_now < play_ms)
+    animator.Animate(++millis_now);
+  unsigned long switched = millis_now;
+  animator.StartAnimation(to, millis_now);
+  int entry = animator.animation_sequence_frame_number();
+  while (animator.animation_sequence_frame_number() == entry)
+    animator.Animate(++millis_now);
+  return millis_now - switched;
+}
+
+TEST_F(ServoAnimatorTest, GaitSwitchBenchmark) {
+  const int kGaits[] = {
+    kAnimationWalk, kAnimationTr, kAnimationCrawl, kAnimationBackUp,
+    kAnimationGait
+  };
+  // Switch points spread over the first stride of the old gait.
+  const unsigned long kPlayMs[] = { 700, 1100, 1500, 1900 };
+  const int kSwitches = sizeof(kPlayMs) / sizeof(kPlayMs[0]);
+  unsigned long total[3] = { 0, 0, 0 };
+  for (int from : kGaits) {
+    for (int to : kGaits) {
+      if (from == to)
+        continue;
+      unsigned long pair[3] = { 0, 0, 0 };
+      for (unsigned long play_ms : kPlayMs) {
+        unsigned long start = TransitionMs(from, to, play_ms,
+                                           kSwitchFromStart);
+        unsigned long nearest = TransitionMs(from, to, play_ms,
+                                             kSwitchNearestPose);
+        pair[0] += start;
+        pair[1] += nearest;
+        pair[2] += TransitionMs(from, to, play_ms, kSwitchMatchPhase);
+        // The first frame is one of the candidates.
+        EXPECT_LE(nearest, start) << from << " to " << to << " at "
+                                  << play_ms << "ms";
+      }
+      printf("Gait %d to %d at 4ms/deg: from start=%lums, nearest pose=%lums, "
+             "match phase=%lums\n", from, to, pair[0] / kSwitches,
+             pair[1] / kSwitches, pair[2] / kSwitches);
+      for (int mode = 0; mode < 3; ++mode)
+        total[mode] += pair[mode];
+    }
+  }
+  const int kPairSwitches = kSwitches * 5 * 4;
+  printf("Average gait switch: from start=%lums, nearest pose=%lums, "
+         "match phase=%lums\n", total[0] / kPairSwitches,
+         total[1] / kPairSwitches, total[2] / kPairSwitches);
+  EXPECT_LT(total[1], total[0] * 3 / 4);
+}
+
+// Plays gait for play_ms and then moves to the balance pose, at once or
+// after its next stable frame. Returns the largest joint move, in degrees,
+// of the blend into the pose, and the ms from the request until it starts.
+static int StopLurch(const EepromSettings* settings, int gait,
+                     unsigned long play_ms, bool graceful,
+                     unsigned long* wait_ms) {
+  ServoAnimator animator;
+  animator.Initialize();
+  animator.SetEepromSettings(settings);
+  animator.Attach();
+  animator.set_ms_per_degree(4);
+  unsigned long millis_now = 0;
+  animator.StartAnimation(gait, millis_now);
+  while (millis_now < play_ms)
+    animator.Animate(++millis_now);
+  unsigned long requested = millis_now;
+  if (graceful)
+    animator.StopAtStableFrame(kAnimationBalance, millis_now);
+  else
+    animator.StartAnimation(kAnimationBalance, millis_now);
+  while (animator.animation_sequence() != kAnimationBalance)
+    animator.Animate(++millis_now);
+  *wait_ms = millis_now - requested;
+  int8_t balance[kServoCount];
+  ServoAnimator::GetFrame(kAnimationBalance, 0, balance);
+  int lurch = 0;
+  for (int i = 0; i < kServoCount; ++i) {
+    int pose = 90 + balance[i] * ServoAnimator::kDirectionMap[i];
+    lurch = std::max(lurch, abs(pose - Degrees(animator, i)));
+  }
+  return lurch;
+}
+
+TEST_F(ServoAnimatorTest, GracefulStopBenchmark) {
+  const int kGaits[] = {
+    kAnimationWalk, kAnimationTr, kAnimationCrawl, kAnimationBackUp,
+    kAnimationGait
+  };
+  int total_abrupt = 0;
+  int total_graceful = 0;
+  int stops = 0;
+  for (int gait : kGaits) {
+    int abrupt = 0;
+    int graceful = 0;
+    unsigned long longest_wait = 0;
+    for (unsigned long play_ms = 700; play_ms < 2700; play_ms += 100) {
+      unsigned long wait_ms;
+      abrupt += StopLurch(&settings_, gait, play_ms, false, &wait_ms);
+      graceful += StopLurch(&settings_, gait, play_ms, true, &wait_ms);
+      longest_wait = std::max(longest_wait, wait_ms);
+      ++stops;
+    }
+    printf("Gait %d to balance: mean lurch %d degrees at once, %d degrees "
+           "from a stable frame reached within %lums\n", gait,
+           abrupt / 20, graceful / 20, longest_wait);
+    total_abrupt += abrupt;
+    total_graceful += graceful;
+  }
+  printf("Mean lurch into balance: %d degrees at once, %d from a stable "
+         "frame\n", total_abrupt / stops, total_graceful / stops);
+  EXPECT_LT(total_graceful, total_abrupt * 9 / 10);
+}
+
+TEST_F(ServoAnimatorTest, StopAtStableFrameWaitsForTheFrame) {
+  SkillInfo info;
+  ASSERT_TRUE(GetSkillInfo(kAnimationWalk, &info));
+  animator_.set_ms_per_degree(4);
+  unsigned long millis_now = 0;
+  animator_.StartAnimation(kAnimationWalk, millis_now);
+  animator_.StopAtStableFrame(kAnimationSit, millis_now);
+  EXPECT_TRUE(animator_.stopping());
+  int stop_frame = std::min(info.stable_frames[0], info.stable_frames[1]);
+  int last_frame = 0;
+  while (animator_.animation_sequence() == kAnimationWalk) {
+    last_frame = animator_.animation_sequence_frame_number();
+    animator_.Animate(++millis_now);
   }
+  EXPECT_EQ(stop_frame, last_frame);
+  EXPECT_EQ(kAnimationSit, animator_.animation_sequence());
+  EXPECT_FALSE(animator_.stopping());
+
+  // Poses have no stable frames and switch at once.
+  animator_.StopAtStableFrame(kAnimationBalance, millis_now);
+  EXPECT_EQ(kAnimationBalance, animator_.animation_sequence());
+}
+
+// Plays two cycles of wkF and returns how many degrees the left front
+// shoulder moves within 4ms either side of each keyframe, which is close to
+// none when it stops there. Also checks that every segment ends on its
+// keyframe.
+int ServoAnimatorTest::KeyframeMotion(InterpolationMode mode) {
+  const int kWindowMs = 4;
+  animator_.Attach();
+  animator_.set_ms_per_degree(4);
+  animator_.set_interpolation_mode(mode);
+  unsigned long millis_now = 0;
+  animator_.StartAnimation(kAnimationWalk, millis_now);
+  int frame_number = animator_.animation_sequence_frame_number();
+  std::vector<int> trajectory;
+  std::vector<int> keyframe_ms;
+  while (keyframe_ms.size() < 2 * 43) {
+    animator_.Animate(++millis_now);
+    trajectory.push_back(Degrees(animator_, kServoLeftFrontShoulder));
+    if (animator_.animation_sequence_frame_number() == frame_number)
+      continue;
+    // The segment that just finished ended on its keyframe.
+    const int8_t* keyframe = Frame(kAnimationWalk, frame_number);
+    for (int i = 0; i < kServoCount; ++i) {
+      EXPECT_EQ(90 + keyframe[i] * animator_.kDirectionMap[i],
+                Degrees(animator_, i))
+          << "servo " << i << " frame " << frame_number;
+    }
+    frame_number = animator_.animation_sequence_frame_number();
+    keyframe_ms.push_back(trajectory.size() - 1);
+  }
+  for (int i = 0; i < kWindowMs; ++i) {
+    animator_.Animate(++millis_now);
+    trajectory.push_back(Degrees(animator_, kServoLeftFrontShoulder));
+  }
+
+  int motion = 0;
+  // Skip the first keyframe, which the robot reaches from its rest pose.
+  for (size_t i = 1; i < keyframe_ms.size(); ++i) {
+    int at = keyframe_ms[i];
+    motion += abs(trajectory[at + kWindowMs] - trajectory[at - kWindowMs]);
+  }
+  return motion;
+}
+
+TEST_F(ServoAnimatorTest, SplinePassesThroughKeyframesWithoutStopping) {
+  int eased = KeyframeMotion(kInterpolateSynchronized);
+  int spline = KeyframeMotion(kInterpolateSpline);
+  printf("Shoulder motion around wkF keyframes: eased=%d, spline=%d degrees\n",
+         eased, spline);
+  EXPECT_GT(spline, eased * 3);
+
+  // Poses still ease to a stop.
+  animator_.StartAnimation(kAnimationCalibrationPose, 0);
+  animator_.Animate(10000);
+  EXPECT_FALSE(animator_.animating());
+}
+
+// Plays wkF for duration_ms, stalling the loop for stall_ms every 100ms as a
+// slow MPU read or Serial print would, and returns the number of keyframes
+// started.
+static int PlayWithStalls(ServoAnimator* animator, unsigned long duration_ms,
+                          unsigned long stall_ms) {
+  unsigned long millis_now = 0;
+  animator->StartAnimation(kAnimationWalk, millis_now);
+  int keyframes = 0;
+  int last_frame = animator->animation_sequence_frame_number();
+  while (millis_now < duration_ms) {
+    millis_now += millis_now % 100 == 99 ? stall_ms : 1;
+    animator->Animate(millis_now);
+    int frame = animator->animation_sequence_frame_number();
+    // Count every keyframe passed, skipped ones included.
+    keyframes += (frame - last_frame + 43) % 43;
+    last_frame = frame;
+  }
+  return keyframes;
+}
+
+TEST_F(ServoAnimatorTest, CadenceLockKeepsStrideFrequency) {
+  // Each run starts from the rest pose with a fresh animator.
+  ServoAnimator animators[4];
+  for (ServoAnimator& animator : animators) {
+    animator.Initialize();
+    animator.SetEepromSettings(&settings_);
+    animator.set_ms_per_degree(4);
+  }
+  int on_time = PlayWithStalls(&animators[0], 10000, 1);
+  int late = PlayWithStalls(&animators[1], 10000, 40);
+  EXPECT_LT(late, on_time * 9 / 10);
+
+  animators[2].set_cadence_locked(true);
+  EXPECT_EQ(on_time, PlayWithStalls(&animators[2], 10000, 1));
+  EXPECT_EQ(0u, animators[2].skipped_frames());
+
+  ServoAnimator* locked_animator = &animators[3];
+  locked_animator->set_cadence_locked(true);
+  int locked = PlayWithStalls(locked_animator, 10000, 40);
+  EXPECT_NEAR(on_time, locked, 1);
+  EXPECT_GT(locked_animator->skipped_frames(), 0u);
+  EXPECT_GT(locked_animator->cadence_lag_ms(), 1000u);
+  printf("Keyframes in 10s: on time=%d, 40ms stalls=%d, locked=%d "
+         "(%u skipped, %lums lag)\n", on_time, late, locked,
+         locked_animator->skipped_frames(), locked_animator->cadence_lag_ms());
+
+  locked_animator->ResetCadenceStats();
+  EXPECT_EQ(0u, locked_animator->skipped_frames());
+  EXPECT_EQ(0u, locked_animator->cadence_lag_ms());
+}
+
+TEST_F(ServoAnimatorTest, CadenceLockCatchesUpMidSegment) {
+  animator_.Attach();
+  animator_.set_cadence_locked(true);
+  animator_.StartAnimation(kAnimationWalk, 0);
+  unsigned long millis_now = 0;
+  while (animator_.animation_sequence_frame_number() == 0)
+    animator_.Animate(++millis_now);
+  // The first segment ended now. Stall for 3ms, less than the next segment:
+  // nothing is skipped and the servos jump to where they are due.
+  ServoAnimator reference = animator_;
+  for (unsigned long ms = millis_now + 1; ms <= millis_now + 3; ++ms)
+    reference.Animate(ms);
+  animator_.Animate(millis_now + 3);
+  EXPECT_EQ(0u, animator_.skipped_frames());
+  for (int i = 0; i < kServoCount; ++i) {
+    EXPECT_EQ(Degrees(reference, i), Degrees(animator_, i))
+        << "servo " << i;
+  }
+}
+
+TEST_F(ServoAnimatorTest, RepeatedPulsesAreNotWritten) {
+  animator_.Attach();
+  for (int i = 0; i < kServoCount; ++i) {
+    EXPECT_EQ(1u, animator_.emitted_writes(i));
+    EXPECT_EQ(0u, animator_.suppressed_writes(i));
+  }
+  animator_.ResetWriteStats();
+
+  // The shoulders move 60 degrees over 600ms, so writes at 1ms steps repeat
+  // pulse widths near the start and end of the eased move.
+  animator_.set_ms_per_degree(10);
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
+  for (unsigned long millis_now = 1; millis_now <= 600; ++millis_now)
+    animator_.Animate(millis_now);
+  EXPECT_EQ(90, Degrees(animator_, kServoLeftFrontShoulder));
+  unsigned int emitted = animator_.emitted_writes(kServoLeftFrontShoulder);
+  unsigned int suppressed =
+      animator_.suppressed_writes(kServoLeftFrontShoulder);
+  EXPECT_EQ(600u, emitted + suppressed);
+  EXPECT_GT(suppressed, 0u);
+  EXPECT_LE(emitted, 600u);
+
+  // A write of the same angle is suppressed, until the servo is reattached.
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 100);
+  animator_.Detach();
+  animator_.Attach();
+  EXPECT_EQ(90, Degrees(animator_, kServoLeftFrontShoulder));
+  EXPECT_EQ(emitted + 1, animator_.emitted_writes(kServoLeftFrontShoulder));
+}
+
+TEST_F(ServoAnimatorTest, SlowMovesStepInMicroseconds) {
+  animator_.Attach();
+  int start_us = animator_.driver_.pulse_us(kServoLeftFrontShoulder);
+  // 60 degrees at 10ms per degree peak at about 1.6us per ms, where whole
+  // degree writes would jump about 10us at a time.
+  animator_.set_ms_per_degree(10);
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
+  int last_us = start_us;
+  int max_step_us = 0;
+  int pulse_widths = 0;
+  for (unsigned long millis_now = 1; millis_now <= 600; ++millis_now) {
+    animator_.Animate(millis_now);
+    int us = animator_.driver_.pulse_us(kServoLeftFrontShoulder);
+    // The shoulder's rest pose is above 90 degrees.
+    ASSERT_LE(us, last_us) << "at " << millis_now << "ms";
+    if (us != last_us)
+      ++pulse_widths;
+    max_step_us = std::max(max_step_us, last_us - us);
+    last_us = us;
+  }
+  EXPECT_LE(max_step_us, 2);
+  // Nearly every microsecond of the move is visited.
+  EXPECT_GE(pulse_widths, (start_us - last_us) / 2);
+  EXPECT_NEAR(kMinPulseUs + (kMaxPulseUs - kMinPulseUs) / 2, last_us, 1);
+  EXPECT_EQ(90, Degrees(animator_, kServoLeftFrontShoulder));
+  printf("60 degrees at 10ms/deg: %d pulse widths from %dus to %dus, "
+         "max step %dus\n", pulse_widths, start_us, last_us, max_step_us);
+}
+
+TEST_F(ServoAnimatorTest, WriteSuppressionStats) {
+  animator_.Attach();
+  animator_.set_ms_per_degree(4);
+  animator_.ResetWriteStats();
+  animator_.StartAnimation(kAnimationWalk, 0);
+  for (unsigned long millis_now = 1; millis_now <= 10000; ++millis_now)
+    animator_.Animate(millis_now);
+  unsigned int emitted = 0;
+  unsigned int suppressed = 0;
+  for (int i = 0; i < kServoCount; ++i) {
+    emitted += animator_.emitted_writes(i);
+    suppressed += animator_.suppressed_writes(i);
+  }
+  EXPECT_GT(suppressed, emitted);
+  printf("wkF for 10s at 4ms/deg: %u writes emitted, %u suppressed\n",
+         emitted, suppressed);
+}
+
+TEST_F(ServoAnimatorTest, SettingsChangesApplyOnlyWhenAnnounced) {
+  animator_.Attach();
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 0);
+  animator_.Animate(10000);
+  EXPECT_EQ(90, Degrees(animator_, kServoHead));
+
+  // Calibrating a zero offset moves the idle servo once announced.
+  settings_.servo_zero_offset[kServoHead] = 4;
+  animator_.StartFrame(Frame(kAnimationCalibrationPose, 0), 10000);
+  animator_.Animate(20000);
+  EXPECT_EQ(90, Degrees(animator_, kServoHead));
+  animator_.EepromSettingsChanged();
+  EXPECT_EQ(94, Degrees(animator_, kServoHead));
+
+  settings_.servo_lower_extents[kServoLeftFrontShoulder] = 10;
+  animator_.EepromSettingsChanged();
+  EXPECT_EQ(100, Degrees(animator_, kServoLeftFrontShoulder));
 }
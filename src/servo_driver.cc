@@ -0,0 +1,239 @@
+#include "servo_driver.h"
+
+#ifndef TESTING
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif  // TESTING
+
+// Pulses ending this close to the one an interrupt ends are ended by the
+// same interrupt, since another one could not start in time for them.
+static const uint16_t kMergeTicks = 8 * kServoTicksPerUs;
+static const uint16_t kDefaultPulseUs = 1500;
+
+#ifndef TESTING
+static ServoDriver* s_driver = nullptr;
+
+ISR(TIMER1_CAPT_vect) {
+  s_driver->OnFrameStart();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  s_driver->OnCompare();
+}
+
+static volatile uint8_t* const kPorts[] = { &PORTB, &PORTC, &PORTD };
+#endif  // TESTING
+
+// Keeps the compiler from moving table edits across the flags that hand the
+// table to the interrupt.
+static inline void Barrier() {
+#ifndef TESTING
+  asm volatile("" ::: "memory");
+#endif  // TESTING
+}
+
+// Port index into kPorts and bit of an ATmega328p Arduino pin.
+static void PinBit(uint8_t pin, uint8_t* port, uint8_t* mask) {
+  if (pin < 8) {
+    *port = 2;
+    *mask = 1 << pin;
+  } else if (pin < 14) {
+    *port = 0;
+    *mask = 1 << (pin - 8);
+  } else {
+    *port = 1;
+    *mask = 1 << (pin - 14);
+  }
+}
+
+void ServoDriver::Begin() {
+#ifndef TESTING
+  s_driver = this;
+  uint8_t old_sreg = SREG;
+  cli();
+  // CTC mode with ICR1 as TOP: the capture interrupt ends each frame and
+  // OCR1A takes effect as soon as it is written.
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
+  ICR1 = uint16_t(kServoFrameUs * kServoTicksPerUs - 1);
+  TCNT1 = 0;
+  TIFR1 = _BV(ICF1) | _BV(OCF1A);
+  TIMSK1 = _BV(ICIE1) | _BV(OCIE1A);
+  SREG = old_sreg;
+#endif  // TESTING
+}
+
+void ServoDriver::Attach(uint8_t channel, uint8_t pin) {
+  if (attached(channel))
+    return;
+  PinBit(pin, &port_[channel], &mask_[channel]);
+#ifndef TESTING
+  digitalWrite(pin, LOW);
+  pinMode(pin, OUTPUT);
+#endif  // TESTING
+  if (pulse_ticks_[channel] == 0)
+    pulse_ticks_[channel] = kDefaultPulseUs * kServoTicksPerUs;
+  attached_mask_ |= 1 << channel;
+
+  PulseTable* table = BeginUpdate();
+  Pulse* pulse = &table->pulses[table->count];
+  pulse->ticks = pulse_ticks_[channel];
+  pulse->channel = channel;
+  Sort(table, table->count++);
+  RebuildStartMasks(table);
+  EndUpdate();
+}
+
+void ServoDriver::Detach(uint8_t channel) {
+  if (!attached(channel))
+    return;
+  attached_mask_ &= ~(1 << channel);
+
+  PulseTable* table = BeginUpdate();
+  uint8_t to = 0;
+  for (uint8_t from = 0; from < table->count; ++from) {
+    if (table->pulses[from].channel != channel)
+      table->pulses[to++] = table->pulses[from];
+  }
+  table->count = to;
+  RebuildStartMasks(table);
+  EndUpdate();
+}
+
+void ServoDriver::Write(uint8_t channel, uint16_t us) {
+  if (us < kMinPulseUs)
+    us = kMinPulseUs;
+  if (us > kMaxPulseUs)
+    us = kMaxPulseUs;
+  uint16_t ticks = us * kServoTicksPerUs;
+  if (ticks == pulse_ticks_[channel])
+    return;
+  pulse_ticks_[channel] = ticks;
+  if (!attached(channel))
+    return;
+
+  PulseTable* table = BeginUpdate();
+  for (uint8_t i = 0; i < table->count; ++i) {
+    if (table->pulses[i].channel == channel) {
+      table->pulses[i].ticks = ticks;
+      Sort(table, i);
+      break;
+    }
+  }
+  EndUpdate();
+}
+
+ServoDriver::PulseTable* ServoDriver::BeginUpdate() {
+  updating_ = true;
+  Barrier();
+  if (!swap_pending_) {
+    // The interrupt took the last update, so edit a copy of what it plays.
+    pending_ = active_ ^ 1;
+    tables_[pending_] = tables_[active_];
+  }
+  return &tables_[pending_];
+}
+
+void ServoDriver::EndUpdate() {
+  Barrier();
+  swap_pending_ = true;
+  updating_ = false;
+}
+
+// Moves the pulse at index to its place in the otherwise sorted table. Only
+// one pulse changes per update, so this is a single pass of insertion sort.
+void ServoDriver::Sort(PulseTable* table, uint8_t index) {
+  Pulse pulse = table->pulses[index];
+  while (index > 0 && table->pulses[index - 1].ticks > pulse.ticks) {
+    table->pulses[index] = table->pulses[index - 1];
+    --index;
+  }
+  while (index + 1 < table->count &&
+         table->pulses[index + 1].ticks < pulse.ticks) {
+    table->pulses[index] = table->pulses[index + 1];
+    ++index;
+  }
+  table->pulses[index] = pulse;
+}
+
+void ServoDriver::RebuildStartMasks(PulseTable* table) {
+  for (uint8_t port = 0; port < kPortCount; ++port)
+    table->start_masks[port] = 0;
+  for (uint8_t i = 0; i < table->count; ++i) {
+    uint8_t channel = table->pulses[i].channel;
+    table->start_masks[port_[channel]] |= mask_[channel];
+  }
+}
+
+void ServoDriver::OnFrameStart() {
+  if (swap_pending_ && !updating_) {
+    active_ = pending_;
+    swap_pending_ = false;
+  }
+  const PulseTable& table = tables_[active_];
+  for (uint8_t port = 0; port < kPortCount; ++port) {
+    if (table.start_masks[port])
+      SetPort(port, table.start_masks[port], true);
+  }
+  next_pulse_ = 0;
+  if (table.count > 0)
+    SetCompare(table.pulses[0].ticks);
+}
+
+void ServoDriver::OnCompare() {
+  const PulseTable& table = tables_[active_];
+  while (next_pulse_ < table.count) {
+    const Pulse& pulse = table.pulses[next_pulse_];
+    if (pulse.ticks > Ticks() + kMergeTicks) {
+      SetCompare(pulse.ticks);
+      return;
+    }
+    WaitUntil(pulse.ticks);
+    SetPort(port_[pulse.channel], mask_[pulse.channel], false);
+#ifdef TESTING
+    fake_end_ticks_[pulse.channel] = Ticks();
+#endif  // TESTING
+    ++next_pulse_;
+  }
+}
+
+uint16_t ServoDriver::Ticks() const {
+#ifndef TESTING
+  return TCNT1;
+#else
+  return fake_ticks_;
+#endif  // TESTING
+}
+
+void ServoDriver::WaitUntil(uint16_t ticks) {
+#ifndef TESTING
+  while (TCNT1 < ticks) {
+  }
+#else
+  if (fake_ticks_ < ticks)
+    fake_ticks_ = ticks;
+#endif  // TESTING
+}
+
+void ServoDriver::SetCompare(uint16_t ticks) {
+#ifndef TESTING
+  OCR1A = ticks;
+#else
+  fake_compare_ = ticks;
+#endif  // TESTING
+}
+
+void ServoDriver::SetPort(uint8_t port, uint8_t mask, bool high) {
+#ifndef TESTING
+  if (high)
+    *kPorts[port] |= mask;
+  else
+    *kPorts[port] &= ~mask;
+#else
+  if (high)
+    fake_ports_[port] |= mask;
+  else
+    fake_ports_[port] &= ~mask;
+#endif  // TESTING
+}
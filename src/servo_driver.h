@@ -0,0 +1,104 @@
+#ifndef _SERVO_DRIVER_H
+#define _SERVO_DRIVER_H
+
+#include <stdint.h>
+
+// Pulse widths that 0 and 180 degrees map to.
+const int kMinPulseUs = 544;
+const int kMaxPulseUs = 2400;
+// Timer1 runs at F_CPU / 8.
+const uint8_t kServoTicksPerUs = 2;
+const uint16_t kServoFrameUs = 20000;
+
+// Generates the pulses of up to kMaxChannels servos from Timer1 alone,
+// replacing the Servo library and its per channel interrupts.
+//
+// Every 20ms frame raises all attached pins together, with one write per
+// port, and a single compare interrupt then ends the pulses in order from a
+// table kept sorted by width. Write only edits a pending copy of the table,
+// without blocking interrupts. The interrupt switches to the pending copy at
+// the start of the next frame, so a frame never mixes old and new widths and
+// the interrupt does the same work whatever the animation writes.
+class ServoDriver {
+ public:
+  static const uint8_t kMaxChannels = 12;
+
+  ServoDriver() {}
+
+  // Takes over Timer1 and starts generating frames.
+  void Begin();
+  // Starts pulsing pin as channel from the next frame on.
+  void Attach(uint8_t channel, uint8_t pin);
+  // Stops the channel's pulses from the next frame on, leaving its pin low.
+  void Detach(uint8_t channel);
+  bool attached(uint8_t channel) const {
+    return attached_mask_ & (1 << channel);
+  }
+  // Sets the pulse width of channel from the next frame on, clamped to
+  // [kMinPulseUs, kMaxPulseUs].
+  void Write(uint8_t channel, uint16_t us);
+  // Width most recently written to channel.
+  uint16_t pulse_us(uint8_t channel) const {
+    return pulse_ticks_[channel] / kServoTicksPerUs;
+  }
+
+  // Timer1 interrupts: the end of the frame at ICR1 and the next pulse end
+  // at OCR1A.
+  void OnFrameStart();
+  void OnCompare();
+
+ private:
+  static const uint8_t kPortCount = 3;
+
+  struct Pulse {
+    uint16_t ticks;
+    uint8_t channel;
+  };
+
+  // Attached channels sorted by width, and the bits to raise on each port.
+  struct PulseTable {
+    Pulse pulses[kMaxChannels];
+    uint8_t count;
+    uint8_t start_masks[kPortCount];
+  };
+
+  PulseTable* BeginUpdate();
+  void EndUpdate();
+  void Sort(PulseTable* table, uint8_t index);
+  void RebuildStartMasks(PulseTable* table);
+  uint16_t Ticks() const;
+  void WaitUntil(uint16_t ticks);
+  void SetCompare(uint16_t ticks);
+  void SetPort(uint8_t port, uint8_t mask, bool high);
+
+  // The interrupt reads tables_[active_]; Write edits tables_[pending_].
+  PulseTable tables_[2] = {};
+  volatile uint8_t active_ = 0;
+  uint8_t pending_ = 0;
+  volatile bool swap_pending_ = false;
+  // Set while tables_[pending_] is edited, which keeps the interrupt from
+  // switching to it.
+  volatile bool updating_ = false;
+  // Index of the next pulse to end in tables_[active_].
+  uint8_t next_pulse_ = 0;
+
+  uint16_t pulse_ticks_[kMaxChannels] = {0};
+  uint16_t attached_mask_ = 0;
+  uint8_t port_[kMaxChannels] = {0};
+  uint8_t mask_[kMaxChannels] = {0};
+
+#ifdef TESTING
+ public:
+  // Stand ins for TCNT1, OCR1A and the PORTB, PORTC and PORTD registers.
+  uint16_t fake_ticks_ = 0;
+  uint16_t fake_compare_ = 0;
+  uint8_t fake_ports_[kPortCount] = {0};
+  // Tick at which each channel's pulse last ended.
+  uint16_t fake_end_ticks_[kMaxChannels] = {0};
+  bool pin_high(uint8_t channel) const {
+    return fake_ports_[port_[channel]] & mask_[channel];
+  }
+#endif  // TESTING
+};
+
+#endif  // _SERVO_DRIVER_H
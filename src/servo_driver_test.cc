@@ -0,0 +1,159 @@
+#include "servo_driver.h"
+
+#include <gtest/gtest.h>
+
+static const uint8_t kPins[] = { 3, 13, 12, 8, 6, 7, 11, 9, 4, 5, 10 };
+static const int kChannels = sizeof(kPins) / sizeof(kPins[0]);
+
+class ServoDriverTest : public testing::Test {
+ protected:
+  void AttachAll() {
+    for (int i = 0; i < kChannels; ++i)
+      driver_.Attach(i, kPins[i]);
+  }
+
+  bool AnyPinHigh() const {
+    for (uint8_t port : driver_.fake_ports_) {
+      if (port)
+        return true;
+    }
+    return false;
+  }
+
+  // Plays one frame on the fake timer and returns the compare interrupts it
+  // took.
+  int RunFrame() {
+    driver_.fake_ticks_ = 0;
+    driver_.OnFrameStart();
+    for (int i = 0; i < kChannels; ++i) {
+      EXPECT_EQ(driver_.attached(i), driver_.pin_high(i)) << "channel " << i;
+    }
+    int interrupts = 0;
+    while (AnyPinHigh() && interrupts <= kChannels) {
+      EXPECT_GT(driver_.fake_compare_, driver_.fake_ticks_);
+      driver_.fake_ticks_ = driver_.fake_compare_;
+      driver_.OnCompare();
+      ++interrupts;
+    }
+    EXPECT_FALSE(AnyPinHigh());
+    return interrupts;
+  }
+
+  uint16_t EndUs(int channel) const {
+    return driver_.fake_end_ticks_[channel] / kServoTicksPerUs;
+  }
+
+  ServoDriver driver_;
+};
+
+TEST_F(ServoDriverTest, PulsesEndInWidthOrder) {
+  AttachAll();
+  for (int i = 0; i < kChannels; ++i)
+    driver_.Write(i, 2300 - i * 150);
+  EXPECT_EQ(kChannels, RunFrame());
+  for (int i = 0; i < kChannels; ++i)
+    EXPECT_EQ(2300 - i * 150, EndUs(i)) << "channel " << i;
+}
+
+TEST_F(ServoDriverTest, AttachStartsAtTheDefaultWidth) {
+  driver_.Attach(0, kPins[0]);
+  EXPECT_TRUE(driver_.attached(0));
+  EXPECT_FALSE(driver_.attached(1));
+  EXPECT_EQ(1500, driver_.pulse_us(0));
+  EXPECT_EQ(1, RunFrame());
+  EXPECT_EQ(1500, EndUs(0));
+}
+
+TEST_F(ServoDriverTest, WidthsAreClamped) {
+  driver_.Write(0, 100);
+  driver_.Write(1, 3000);
+  EXPECT_EQ(kMinPulseUs, driver_.pulse_us(0));
+  EXPECT_EQ(kMaxPulseUs, driver_.pulse_us(1));
+}
+
+TEST_F(ServoDriverTest, WritesApplyFromTheNextFrame) {
+  AttachAll();
+  RunFrame();
+
+  // A write in the middle of a frame leaves that frame alone.
+  driver_.fake_ticks_ = 0;
+  driver_.OnFrameStart();
+  driver_.Write(4, 900);
+  driver_.Write(5, 2000);
+  while (AnyPinHigh()) {
+    driver_.fake_ticks_ = driver_.fake_compare_;
+    driver_.OnCompare();
+  }
+  EXPECT_EQ(1500, EndUs(4));
+  EXPECT_EQ(1500, EndUs(5));
+
+  RunFrame();
+  EXPECT_EQ(900, EndUs(4));
+  EXPECT_EQ(2000, EndUs(5));
+
+  // Later writes edit a fresh copy of what the interrupt now plays.
+  driver_.Write(4, 1200);
+  RunFrame();
+  EXPECT_EQ(1200, EndUs(4));
+  EXPECT_EQ(2000, EndUs(5));
+}
+
+TEST_F(ServoDriverTest, CloseWidthsShareOneInterrupt) {
+  driver_.Attach(0, kPins[0]);
+  driver_.Attach(1, kPins[1]);
+  driver_.Attach(2, kPins[2]);
+  driver_.Write(0, 1500);
+  driver_.Write(1, 1504);
+  driver_.Write(2, 1600);
+  EXPECT_EQ(2, RunFrame());
+  // The shared interrupt waits for each pulse's own end.
+  EXPECT_EQ(1500, EndUs(0));
+  EXPECT_EQ(1504, EndUs(1));
+  EXPECT_EQ(1600, EndUs(2));
+}
+
+TEST_F(ServoDriverTest, DetachStopsPulsesFromTheNextFrame) {
+  AttachAll();
+  RunFrame();
+  driver_.fake_ticks_ = 0;
+  driver_.OnFrameStart();
+  driver_.Detach(3);
+  EXPECT_FALSE(driver_.attached(3));
+  EXPECT_TRUE(driver_.pin_high(3));
+  while (AnyPinHigh()) {
+    driver_.fake_ticks_ = driver_.fake_compare_;
+    driver_.OnCompare();
+  }
+  EXPECT_FALSE(driver_.pin_high(3));
+
+  driver_.fake_end_ticks_[3] = 0;
+  RunFrame();
+  EXPECT_EQ(0, driver_.fake_end_ticks_[3]);
+
+  // Writes while detached apply on the next attach.
+  driver_.Write(3, 700);
+  driver_.Attach(3, kPins[3]);
+  RunFrame();
+  EXPECT_EQ(700, EndUs(3));
+}
+
+TEST_F(ServoDriverTest, TableStaysSortedThroughRandomWrites) {
+  AttachAll();
+  uint16_t widths[kChannels];
+  for (int i = 0; i < kChannels; ++i)
+    widths[i] = 1500;
+  uint32_t seed = 12345;
+  for (int frame = 0; frame < 200; ++frame) {
+    for (int write = 0; write < 20; ++write) {
+      seed = seed * 1103515245 + 12345;
+      int channel = (seed >> 16) % kChannels;
+      uint16_t us = kMinPulseUs + (seed >> 8) % (kMaxPulseUs - kMinPulseUs);
+      driver_.Write(channel, us);
+      widths[channel] = us;
+    }
+    RunFrame();
+    for (int i = 0; i < kChannels; ++i) {
+      ASSERT_EQ(widths[i], EndUs(i)) << "channel " << i << " frame " << frame;
+    }
+  }
+}
@@ -0,0 +1,293 @@
+// Generated by skill_frames_gen from Instinct.h. Do not edit.
+
+static const int kSkillCount = 44;
+
+static const uint8_t kSkillData[] PROGMEM = {
+  // 0: bdI
+  0x12, 0x12, 0xaa, 0xaa, 0x12, 0x12, 0x03, 0x03, 0x81, 0xa8, 0x1a, 0x77,
+  0x22, 0x8f, 0xa8, 0xfa, 0x66, 0x77, 0x77, 0x8f, 0x28, 0xf2, 0x11, 0x77,
+  0x82, 0x88, 0x28, 0xbb, 0xdd, 0x44, 0x83, 0x68, 0x36, 0xff, 0x33, 0x33,
+  0x22, 0x33, 0x66, 0x33, 0xbb, 0x11, 0x83, 0x08, 0x30, 0x33, 0x82, 0x88,
+  0x28, 0x11, 0x83, 0x98, 0x39, 0x33, 0x81, 0xd8, 0x1d, 0x11, 0x84, 0x18,
+  0x41, 0x55, 0x81, 0x08, 0x10, 0xff, 0x77, 0x55, 0x80, 0x48, 0x04, 0xff,
+  0x44, 0x44, 0x8f, 0xb8, 0xfb, 0xee, 0x22, 0x66, 0x8f, 0x28, 0xf2, 0xee,
+  0xee, 0x33, 0x8e, 0xa8, 0xea, 0x33, 0x99, 0x00, 0x8e, 0x08, 0xe0, 0x77,
+  0x83, 0x88, 0x38, 0xee, 0xbb, 0x8f, 0xe8, 0xfe, 0x82, 0x78, 0x27, 0xcc,
+  0x00, 0x80, 0x88, 0x08, 0x81, 0x48, 0x14, 0xcc, 0x55, 0x81, 0x18, 0x11,
+  0x80, 0x28, 0x02, 0x99, 0x8e, 0x98, 0xe9, 0x81, 0x98, 0x19, 0x8f, 0x78,
+  0xf7, 0x8c, 0xd8, 0xcd, 0x8f, 0x18, 0xf1, 0x77, 0x99, 0x8c, 0x48, 0xc4,
+  0x8f, 0xa8, 0xfa, 0x55, 0xaa, 0xaa, 0x80, 0x38, 0x03, 0x22, 0xbb, 0xaa,
+  0x80, 0xf8, 0x0f, 0x11, 0xbb, 0xbb, 0x81, 0xb8, 0x1b, 0x00, 0xdd, 0xbb,
+  0x82, 0x78, 0x27, 0x00, 0xdd, 0xbb, 0x83, 0x18, 0x31, 0xff, 0x22, 0xbb,
+  0x55, 0xff, 0x55, 0xbb, 0xdd, 0xdd, 0x8e, 0xd8, 0xed, 0xee, 0x82, 0x68,
+  0x26, 0xaa, 0x8f, 0xb8, 0xfb, 0x22, 0x81, 0xa8, 0x1a, 0x81, 0x58, 0x15,
+  0x80, 0x88, 0x08, 0x44, 0xaa, 0x80, 0xd8, 0x0d,
+  // 1: bkI
+  0x1e, 0x27, 0xc7, 0xc0, 0x06, 0xf7, 0xfa, 0x09, 0xd8, 0x33, 0xf8, 0xc9,
+  0x2e, 0xe2, 0xd8, 0x3d, 0xe8, 0xd5, 0x11, 0xff, 0xd5, 0xf7, 0x22, 0xed,
+  0xd0, 0xf5, 0x24, 0xed, 0xce, 0xf3, 0x35, 0xdb, 0xdd, 0x01, 0x25, 0xeb,
+  0xdc, 0xff, 0x31, 0xdf, 0xcf, 0x0d, 0x3f, 0xd1, 0xce, 0x0d, 0x4f, 0xc1,
+  0xde, 0x0d, 0x3f, 0xc1, 0xbe, 0x1d, 0x60, 0xb0, 0xee, 0xfd, 0x1f, 0xf1,
+  0x0d, 0xce, 0xc0, 0x40, 0x4e, 0xcd, 0x81, 0xa0, 0x8e, 0x60, 0x4d, 0xde,
+  0x90, 0x7f, 0x80, 0x6d, 0x0e, 0x91, 0x70, 0x81, 0x4d, 0x2e, 0x80, 0x11,
+  0x8f, 0xff, 0x82, 0x1d, 0x5e, 0x91, 0x7f, 0x82, 0xdd, 0x8c, 0x5e, 0xc1,
+  0x4f, 0x83, 0x8d, 0x8c, 0xff, 0xf2, 0x1e, 0x84, 0x1d, 0x8d, 0xbf, 0x32,
+  0xdf, 0x1d, 0x4f, 0x22, 0xed, 0x0d, 0x3e, 0x42, 0xce, 0xdc, 0x30, 0x52,
+  0xae, 0xcd, 0x0f, 0x43, 0xdd, 0xec, 0xd0, 0x03, 0x0d, 0xed, 0xd0, 0xe3,
+  0x2d, 0xec, 0xd0, 0x04, 0x0c, 0xec, 0xd0, 0xf4, 0x1c, 0xec, 0xe0, 0xf4,
+  0x1c, 0xd0, 0xdd, 0x0d, 0x03, 0xe2, 0xec, 0x0a, 0x06, 0xd4, 0xdd, 0x09,
+  0x07, 0xe5, 0xef, 0x1a, 0xf6, 0xd8, 0x0f, 0xe1, 0x18, 0x04, 0xf8, 0xfc,
+  0xd8, 0x1c, 0xe4, 0x08, 0xfc, 0x08, 0x04,
+  // 4: crI
+  0x23, 0x25, 0xd2, 0xcb, 0xe9, 0xe0, 0xfd, 0x0c, 0x58, 0x1c, 0x4a, 0xf4,
+  0xf0, 0x58, 0x14, 0x4b, 0xf4, 0xf0, 0x68, 0x0c, 0x4b, 0xf5, 0xee, 0x58,
+  0x04, 0x4d, 0xf6, 0xee, 0x48, 0xfb, 0x41, 0x18, 0x01, 0xf8, 0xfc, 0x46,
+  0x57, 0x0e, 0xcb, 0x45, 0x42, 0x2c, 0xd3, 0x65, 0xa3, 0x8d, 0xeb, 0x8f,
+  0xe1, 0xa5, 0xa2, 0xed, 0x51, 0x83, 0xc5, 0x93, 0xfd, 0x31, 0x83, 0x46,
+  0xa3, 0x1c, 0x30, 0x82, 0xc5, 0xa4, 0x2e, 0x20, 0x82, 0x35, 0xa3, 0x3f,
+  0x10, 0x81, 0xa5, 0xb4, 0x4e, 0x0f, 0x96, 0xb4, 0x4f, 0xfe, 0x80, 0xb5,
+  0xb4, 0x6f, 0xff, 0x80, 0x35, 0xc4, 0x61, 0xed, 0x94, 0x45, 0x80, 0x20,
+  0x8f, 0x9d, 0x64, 0x54, 0xc0, 0xfe, 0x58, 0x4b, 0x33, 0xcd, 0x13, 0x5c,
+  0x28, 0xe7, 0xca, 0x28, 0x00, 0x59, 0x39, 0xdf, 0x14, 0x58, 0x38, 0x29,
+  0xd0, 0x23, 0x68, 0x30, 0x4a, 0xd1, 0xf2, 0x58, 0x27, 0x3a, 0xd3, 0x02,
+  // 7: lyI
+  0x72, 0x75, 0xd3, 0xcb, 0x34, 0x31, 0xda, 0xe8, 0x00, 0x6b, 0x00, 0xc1,
+  0x00, 0x5c, 0x00, 0xc2, 0x0f, 0x8e, 0x6c, 0x0f, 0x8c, 0xaf, 0x00, 0x40,
+  0x20, 0xbd, 0x00, 0xd2, 0x00, 0x8c, 0xeb, 0x1f, 0xb4, 0xe2, 0x8d, 0x6c,
+  0x10, 0xb2, 0xe0, 0x60, 0x00, 0x94, 0x00, 0x50, 0x00, 0xb5, 0x00, 0x3e,
+  0x1f, 0xa6, 0xf2, 0x3d, 0x00, 0xb6, 0x00, 0x3b, 0x00, 0xb7, 0x00, 0x1a,
+  0xf0, 0xd8, 0xea, 0xf2, 0xf8, 0xc5, 0x00, 0x0e, 0x00, 0xd5, 0x01, 0x3d,
+  0x0e, 0xa7, 0xf1, 0x3c, 0x2e, 0xd6, 0x00, 0x29, 0x00, 0x17, 0x00, 0x5a,
+  0x00, 0xf5, 0x00, 0x5a, 0x00, 0xe3,
+  // 8: stairN
+  0x2c, 0x5a, 0xd9, 0xda, 0x0a, 0xe0, 0xf6, 0x20, 0x10, 0x78, 0xd2, 0x6a,
+  0xa6, 0xfe, 0x8e, 0x89, 0x81, 0x8b, 0x8e, 0x85, 0xee, 0x7c, 0x82, 0x1e,
+  0x8d, 0xf2, 0x0d, 0x4b, 0x4f, 0xc1, 0xfd, 0x3b, 0x4f, 0xc1, 0x1c, 0x3c,
+  0x10, 0xe1, 0x0c, 0x3c, 0x30, 0xe0, 0x1b, 0x2c, 0x00, 0xff, 0x3d, 0x1e,
+  0xf1, 0x2f, 0x2b, 0x0d, 0xe2, 0x2e, 0x3c, 0x0f, 0xe2, 0x2e, 0x3c, 0x00,
+  0xd3, 0x3d, 0x4d, 0xf0, 0xb3, 0x5d, 0x3d, 0xf1, 0xc3, 0x4c, 0x4d, 0xf1,
+  0xc4, 0x4d, 0x3e, 0xf2, 0xb4, 0x5c, 0x4e, 0xf2, 0xc3, 0x4d, 0x2f, 0xe2,
+  0xc3, 0x4d, 0x3f, 0xf3, 0xc3, 0x4d, 0x30, 0xd3, 0xb4, 0x5c, 0x20, 0xf4,
+  0xc3, 0x4d, 0x31, 0xd3, 0xc2, 0x4e, 0x11, 0xe3, 0xc2, 0x4e, 0x11, 0xd3,
+  0xc2, 0x4e, 0x23, 0xe7, 0xd4, 0x3c, 0x11, 0x97, 0x8e, 0x75, 0x81, 0x9b,
+  0x02, 0x8d, 0xa6, 0x95, 0x7b, 0x00, 0x8d, 0x27, 0xa6, 0x6a, 0xef, 0x98,
+  0xe9, 0xb8, 0x19, 0x58, 0xe6, 0xee, 0xc7, 0xe8, 0x21, 0x29, 0xd0, 0xb4,
+  0xf5, 0x1b, 0xd0, 0xb3, 0xf3, 0x1d, 0xc0, 0xc2, 0x02, 0x1e, 0xc0, 0xc3,
+  0x02, 0x0e, 0xb2, 0xc1, 0x00, 0xf1, 0xd2, 0xe2, 0x1f, 0xff, 0xb2, 0xd1,
+  0x2f, 0xe2, 0xc4, 0xff, 0x2c, 0xe3, 0xc3, 0x00, 0x3d, 0xd4, 0xd4, 0x0f,
+  0x3c, 0xd4, 0xd3, 0x1f, 0x3b, 0xc5, 0xd4, 0x1f, 0x4c, 0xd4, 0xe3, 0x2f,
+  0x4b, 0xc5, 0xe3, 0x2f, 0x3d, 0xd3, 0xf3, 0x2e, 0x3b, 0xd5, 0xf3, 0x3e,
+  0x3c, 0xd4, 0x03, 0x3e, 0x4b, 0xc5, 0x02, 0x4e, 0x3c, 0xd4, 0x12, 0x3e,
+  0x2c, 0xe4, 0x12, 0x3d, 0x2c, 0xe4, 0x11, 0x3e, 0x2c, 0xe4, 0x32, 0x7c,
+  0x4c, 0xc4, 0x10, 0x79, 0x59, 0xb7,
+  // 9: trI
+  0x23, 0x26, 0xd7, 0xd2, 0x0b, 0x02, 0xf6, 0xff, 0x48, 0x17, 0x48, 0xc7,
+  0x07, 0xfc, 0x48, 0x06, 0x49, 0x08, 0x15, 0xf8, 0xf3, 0x38, 0xf4, 0x5e,
+  0x08, 0x27, 0xf8, 0xe5, 0x4b, 0x53, 0x18, 0x31, 0xd9, 0x2d, 0x54, 0x28,
+  0x39, 0xda, 0x36, 0x51, 0x38, 0x31, 0xd4, 0x27, 0x6f, 0x38, 0x29, 0xb6,
+  0x17, 0x61, 0x48, 0x21, 0xb5, 0x06, 0x61, 0x5b, 0x94, 0x36, 0x22, 0xeb,
+  0x14, 0x45, 0xb2, 0x81, 0x3d, 0x8e, 0x32, 0xf5, 0x8f, 0x83, 0x9c, 0x8e,
+  0xc2, 0x95, 0x8e, 0x83, 0x80, 0x4e, 0x8f, 0x82, 0x82, 0xe5, 0x8d, 0x93,
+  0xde, 0x61, 0x82, 0x04, 0x8c, 0xd4, 0x3f, 0x00, 0x81, 0x04, 0x8c, 0x44,
+  0x80, 0xd0, 0xbf, 0x8f, 0xf4, 0xb5, 0x81, 0xb0, 0x8e, 0xef, 0x8f, 0x34,
+  0x05, 0x82, 0x91, 0x8e, 0x3e, 0xa3, 0x45, 0x83, 0x51, 0x8d, 0xbd, 0x12,
+  0x35, 0x22, 0xed, 0x73, 0xf6, 0x82, 0xd3, 0x5c, 0x71, 0x15, 0x94, 0x6b,
+  0x61, 0x06, 0x94, 0x5a, 0x61, 0x26, 0xb3, 0x4b, 0x64, 0x2f, 0xcb, 0x35,
+  0x52, 0x2b, 0xca, 0x28, 0xe5, 0x5c, 0x38, 0xf1, 0xd8, 0x08, 0x28, 0xf2,
+  0x58, 0x35, 0x38, 0xe2, 0xea, 0x18, 0xfb, 0x58, 0x28, 0x48, 0xd4, 0xf0,
+  0x14,
+  // 10: trLI
+  0x21, 0x25, 0xd8, 0xd3, 0x0a, 0xff, 0xf3, 0xfd, 0x28, 0x16, 0x4c, 0x06,
+  0xf0, 0x18, 0x06, 0x5d, 0xf8, 0x11, 0xff, 0x28, 0xf9, 0x4e, 0x08, 0x1f,
+  0xfe, 0x19, 0x51, 0x08, 0x2f, 0xdd, 0x14, 0x52, 0xfe, 0xef, 0x27, 0x61,
+  0x09, 0xb0, 0x16, 0x51, 0x0a, 0xc1, 0x16, 0x71, 0x2b, 0x90, 0x36, 0xc1,
+  0xcb, 0x8e, 0x70, 0xf5, 0x8f, 0x42, 0xdd, 0x8f, 0x30, 0xc5, 0x8e, 0x41,
+  0x0d, 0x8f, 0xd0, 0xc5, 0x8d, 0x51, 0x1e, 0x50, 0xb4, 0x8c, 0x92, 0x10,
+  0x00, 0xc4, 0x8c, 0x01, 0x2f, 0xb0, 0xb4, 0xb1, 0x30, 0x8f, 0x30, 0xc3,
+  0x42, 0x41, 0x8e, 0x70, 0x03, 0x8c, 0x71, 0x21, 0x8d, 0xf0, 0x23, 0x01,
+  0xf2, 0x40, 0x22, 0x12, 0xf3, 0x5f, 0x12, 0x22, 0xf3, 0x40, 0x25, 0x10,
+  0xfe, 0x31, 0x25, 0x3e, 0x08, 0x08, 0x23, 0x1b, 0x3c, 0xf9, 0x12, 0x28,
+  0x31, 0x3b, 0xfc, 0x11,
+  // 11: trRI
+  0x1f, 0x24, 0xd6, 0xcf, 0x0f, 0x05, 0xf7, 0x03, 0x4b, 0x18, 0xc3, 0xf1,
+  0x0e, 0x4b, 0x1a, 0xf2, 0x08, 0xf9, 0x4c, 0x2f, 0x13, 0x08, 0xee, 0x4e,
+  0x17, 0x04, 0x08, 0xe1, 0x21, 0x14, 0x20, 0x00, 0x31, 0x21, 0x20, 0xf5,
+  0x23, 0x21, 0x3e, 0x04, 0x11, 0x21, 0x50, 0xe3, 0x83, 0xf1, 0xf3, 0x80,
+  0xff, 0x43, 0x13, 0xd2, 0x80, 0x5f, 0x32, 0x83, 0x71, 0xb4, 0xa0, 0x11,
+  0x82, 0xc1, 0xc3, 0xef, 0x10, 0x81, 0xe2, 0xc5, 0x50, 0x0f, 0x80, 0xf1,
+  0xc4, 0x80, 0xaf, 0xf0, 0x8f, 0xe2, 0xd4, 0x81, 0x90, 0xfe, 0x8f, 0x52,
+  0x05, 0x82, 0x80, 0xdf, 0xe1, 0x35, 0x83, 0x1f, 0xdd, 0x71, 0x15, 0x90,
+  0x1c, 0x62, 0x16, 0x90, 0x0c, 0x61, 0x06, 0xa0, 0x1b, 0x62, 0x22, 0xbf,
+  0x01, 0x51, 0x18, 0xf8, 0xcd, 0x08, 0xef, 0x6d, 0x18, 0xea, 0xdf, 0x08,
+  0xfa, 0x4b, 0x28, 0xdb, 0xe1, 0x07,
+  // 12: vtI
+  0x33, 0x27, 0xc7, 0xd5, 0xee, 0x07, 0x13, 0xf9, 0x82, 0xa0, 0x8d, 0x10,
+  0x80, 0x10, 0x80, 0x00, 0xd0, 0x40, 0x60, 0x90, 0x00, 0x00, 0x00, 0x00,
+  0x03, 0x0c, 0x09, 0x07, 0x08, 0x33, 0x08, 0xc7, 0x08, 0xed, 0x08, 0x13,
+  0x08, 0x3b, 0x08, 0xbd, 0x08, 0xdc, 0x08, 0x24, 0x00, 0x01, 0x01, 0x00,
+  0x08, 0x33, 0x08, 0xc7, 0x08, 0xee, 0x08, 0x13, 0x08, 0x2a, 0x08, 0xd1,
+  0x08, 0x01, 0x08, 0x00, 0x0d, 0x04, 0x06, 0x09, 0x00, 0x00, 0x00, 0x00,
+  0x10, 0xe0, 0xc0, 0x40, 0x83, 0x20, 0x8c, 0x80, 0x8f, 0x00, 0x81, 0x00,
+  0x83, 0xa0, 0x8b, 0xf0, 0x8d, 0xf0, 0x82, 0x10, 0x20, 0xd0, 0xb0, 0x50,
+  0x83, 0x40, 0x8c, 0x50, 0x8e, 0xb0, 0x81, 0x60,
+  // 13: wkFI
+  0x14, 0x39, 0xbf, 0xcc, 0x03, 0x0a, 0x0a, 0xfa, 0xc2, 0xb2, 0x72, 0xd0,
+  0x11, 0xd2, 0x51, 0xc1, 0x20, 0xe2, 0xf2, 0xb0, 0x31, 0xe1, 0xe1, 0x90,
+  0x21, 0x22, 0xf3, 0x90, 0x30, 0x63, 0xe2, 0x8e, 0x60, 0x31, 0x62, 0xf2,
+  0xaf, 0x22, 0x02, 0xf1, 0x30, 0x26, 0x03, 0xf9, 0x3f, 0x34, 0x02, 0x08,
+  0x08, 0x3f, 0x21, 0x12, 0xfb, 0x2f, 0x2d, 0x03, 0x0b, 0x2f, 0x2d, 0x12,
+  0x0b, 0x3f, 0x2b, 0x03, 0x0d, 0x12, 0x2b, 0x1d, 0x0e, 0x28, 0xff, 0x2a,
+  0x1b, 0x0f, 0x16, 0x29, 0x1a, 0x11, 0x23, 0x28, 0x27, 0x28, 0xd5, 0x02,
+  0x13, 0x18, 0x1f, 0x19, 0x23, 0x11, 0x29, 0x29, 0x04, 0x10, 0x1a, 0x1a,
+  0x27, 0x1f, 0x1e, 0x2b, 0x18, 0x0c, 0x0d, 0x12, 0x2c, 0x13, 0x1d, 0x12,
+  0x2d, 0x2e, 0x0b, 0x13, 0x2f, 0x2f, 0x0a, 0x12, 0x20, 0x2e, 0x09, 0x03,
+  0x24, 0x2f, 0x08, 0xea, 0x12, 0x27, 0x2f, 0xf8, 0xe2, 0x03, 0x32, 0x3f,
+  0x00, 0x52, 0x20, 0xcf, 0xf3, 0x62, 0x20, 0x80, 0xc0, 0xf2, 0x22, 0x31,
+  0x80, 0x4f, 0xf3, 0xe3, 0x20, 0xb0, 0xf3, 0xd2, 0x30, 0xc0, 0xe2, 0xc2,
+  0x11, 0xc0, 0x51, 0xb2, 0xd1, 0xe0, 0x80, 0x12, 0xa2, 0xb1, 0xe0, 0x52,
+  0x91, 0x91, 0x11, 0x32, 0x92, 0x91, 0x11, 0x21, 0x82, 0x21, 0x8c, 0xc2,
+  0x30, 0x11, 0x81, 0xa2, 0xa1, 0x31, 0x01, 0xa1, 0xa2, 0x62, 0xf1,
+  // 14: wkLI
+  0x20, 0x2d, 0xcc, 0xdb, 0x14, 0x22, 0xfa, 0xed, 0x11, 0x8c, 0x41, 0x02,
+  0x90, 0x10, 0xf0, 0x01, 0x90, 0x01, 0x41, 0x02, 0x8e, 0x20, 0x10, 0x8c,
+  0xf0, 0x02, 0x8d, 0x60, 0x00, 0x21, 0x02, 0x00, 0x02, 0x00, 0x02, 0x20,
+  0x18, 0x3c, 0x11, 0x08, 0x1b, 0x30, 0x01, 0x00, 0x08, 0x10, 0x1f, 0x19,
+  0x11, 0x08, 0x08, 0x20, 0x18, 0x2b, 0x00, 0x0d, 0x10, 0x08, 0x1e, 0x11,
+  0x03, 0x10, 0x18, 0x11, 0x11, 0x07, 0x20, 0x09, 0x00, 0x08, 0x17, 0x00,
+  0x0b, 0x11, 0x08, 0x22, 0x10, 0x1f, 0x10, 0x06, 0x1f, 0x13, 0x11, 0x0f,
+  0x10, 0x02, 0x20, 0x0e, 0x02, 0x02, 0x1d, 0x0e, 0x14, 0x12, 0x1d, 0x0f,
+  0x02, 0x02, 0x1c, 0x0e, 0x00, 0x12, 0x2c, 0x1f, 0x00, 0x02, 0x1d, 0x0f,
+  0x00, 0x02, 0x2d, 0x0f, 0x0f, 0x12, 0x11, 0x0f, 0x0e, 0x02, 0x21, 0x0f,
+  0xfd, 0x01, 0x22, 0x00, 0x0e, 0x12, 0x11, 0x1f, 0xf0, 0x31, 0x20, 0xc0,
+  0xf0, 0x12, 0x20, 0xc0, 0x01, 0xd2, 0x21, 0xf0, 0xf0, 0xc1, 0x20, 0xf0,
+  0xe0, 0xc1, 0x21, 0x00, 0xf0, 0xc1, 0x20, 0x10, 0xf0, 0xe2, 0x20, 0x10,
+  0xe0, 0xe1, 0x21, 0x31, 0xe0, 0xf1, 0x20, 0x40, 0xf1, 0x01, 0x30, 0x01,
+  0xd0, 0x11, 0x11, 0xf1, 0x40, 0x11, 0x8f, 0x51, 0x01, 0x8e, 0xc0, 0x01,
+  0x8e, 0x90, 0x01, 0x8f, 0x40, 0x11, 0x8d, 0xb1, 0x01, 0x60, 0x00, 0x8c,
+  0xe0, 0x01, 0x10,
+  // 15: wkRI
+  0x11, 0x2b, 0xd5, 0xdf, 0x1f, 0x15, 0xf3, 0xe6, 0x20, 0xd1, 0xf0, 0x00,
+  0x21, 0xf2, 0xf0, 0xe0, 0x20, 0x01, 0xf0, 0xe0, 0x20, 0x22, 0xf0, 0xdf,
+  0x11, 0x12, 0x00, 0xf0, 0x21, 0x11, 0xf0, 0x0f, 0x12, 0x02, 0x0c, 0x1f,
+  0x20, 0x02, 0x0d, 0x00, 0x2d, 0x12, 0x0f, 0x0f, 0x1d, 0x02, 0x0f, 0x0e,
+  0x1c, 0x12, 0x00, 0x0f, 0x1c, 0x02, 0x01, 0x0f, 0x2d, 0x12, 0x02, 0x0e,
+  0x1f, 0x02, 0x13, 0x0e, 0x1f, 0x02, 0x03, 0x1f, 0x11, 0x13, 0x1f, 0x0d,
+  0x10, 0x01, 0x10, 0x04, 0x11, 0x18, 0xf5, 0x10, 0x08, 0xec, 0x10, 0x08,
+  0xe9, 0x10, 0x08, 0xf4, 0x11, 0x18, 0xdb, 0x10, 0x06, 0x00, 0x08, 0xce,
+  0x10, 0x01, 0x11, 0x18, 0xc6, 0x20, 0x0a, 0x01, 0x0c, 0x20, 0x09, 0x10,
+  0x14, 0x10, 0x08, 0xe5, 0x01, 0x06, 0x20, 0x08, 0xd9, 0x00, 0x15, 0x30,
+  0x0d, 0x00, 0x00, 0x30, 0x02, 0x83, 0xa1, 0x11, 0x82, 0x00, 0x02, 0x40,
+  0x00, 0x81, 0x30, 0xf2, 0xa1, 0x10, 0x80, 0x90, 0x01, 0x82, 0xe1, 0x01,
+  0xc0, 0x02, 0x82, 0x10, 0x11, 0x20, 0x01, 0x81, 0x21, 0x11, 0x80, 0xf0,
+  0x01, 0xa0, 0x00, 0x50, 0x01, 0xa0, 0x11, 0x82, 0x00, 0x01, 0xd1, 0x01,
+  0x82, 0x80, 0xf1, 0x31, 0x11, 0xf0, 0x01, 0x30, 0x01, 0xe0, 0x20, 0x20,
+  0xd1, 0xf0, 0x41, 0x21, 0xd2, 0xe0, 0x20, 0x20, 0xc1, 0xf0, 0x00, 0x21,
+  0xc1, 0xe1, 0x00,
+  // 16: balanceI
+  0x00, 0x00, 0x00, 0x1e, 0x1e, 0xe2, 0xe2, 0x1e, 0x1e, 0xe2, 0xe2,
+  // 17: buttUpI
+  0x14, 0x28, 0x00, 0x5a, 0x5a, 0xd3, 0xd3, 0xc4, 0xc4, 0xfb, 0xfb,
+  // 18: calibI
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 19: cd1I
+  0x14, 0xd3, 0x1e, 0x46, 0x46, 0xd3, 0xd3, 0xc4, 0xc4, 0x00, 0x00,
+  // 20: cd2I
+  0xe2, 0xe2, 0x00, 0x46, 0x46, 0xd3, 0xd3, 0xc4, 0xc4, 0x00, 0x00,
+  // 21: droppedI
+  0x00, 0x1e, 0x00, 0xb5, 0xb5, 0xc4, 0xc4, 0x3c, 0x3c, 0x1e, 0x1e,
+  // 22: liftedI
+  0x00, 0xba, 0x00, 0x37, 0x37, 0x14, 0x14, 0x2d, 0x2d, 0x00, 0x00,
+  // 23: peeI
+  0x2d, 0x14, 0x00, 0x2d, 0x2d, 0xba, 0xf1, 0x0f, 0x2d, 0x1e, 0xec,
+  // 24: pee1I
+  0x2d, 0x0a, 0x00, 0x2d, 0x1e, 0xe2, 0xf1, 0x0f, 0x2d, 0xe2, 0x00,
+  // 25: pu1I
+  0x00, 0xe2, 0x00, 0x14, 0x14, 0x3c, 0x3c, 0x3c, 0x3c, 0xc9, 0xc9,
+  // 26: pu2I
+  0x00, 0x0a, 0x00, 0x3c, 0x3c, 0x28, 0x28, 0xd3, 0xd3, 0xc9, 0xc9,
+  // 27: rc1I
+  0x00, 0xb0, 0x00, 0x3c, 0x3c, 0x3c, 0x3c, 0xd3, 0xd3, 0xd3, 0xd3,
+  // 28: rc10I
+  0x2d, 0xb0, 0x00, 0xb0, 0x0f, 0xf1, 0x46, 0x3c, 0x3c, 0xc9, 0x00,
+  // 29: rc2I
+  0x00, 0x14, 0x00, 0x3c, 0x3c, 0x3c, 0x41, 0x3c, 0x3c, 0xc9, 0xc9,
+  // 30: rc3I
+  0xc4, 0x14, 0x00, 0x0f, 0x0f, 0xf1, 0xf1, 0x3c, 0x3c, 0xc9, 0xc9,
+  // 31: rc4I
+  0xc4, 0x32, 0x00, 0x0f, 0x0f, 0xf1, 0xf1, 0x3c, 0x3c, 0xc9, 0xc9,
+  // 32: rc5I
+  0x32, 0x32, 0x00, 0x0f, 0x0f, 0xf1, 0xf1, 0x3c, 0x3c, 0xc9, 0xbf,
+  // 33: rc6I
+  0x32, 0x14, 0x00, 0xb0, 0x0f, 0xf1, 0x46, 0x3c, 0x3c, 0xc9, 0xbf,
+  // 34: rc7I
+  0x2d, 0xb0, 0x00, 0xb0, 0x3c, 0x3c, 0x46, 0x3c, 0x3c, 0xc9, 0xbf,
+  // 35: rc8I
+  0x2d, 0xb0, 0xdd, 0xb0, 0x0f, 0xf1, 0x46, 0x3c, 0xc4, 0x37, 0xbf,
+  // 36: rc9I
+  0x2d, 0xb0, 0xba, 0xb0, 0x0f, 0xf1, 0x46, 0x3c, 0x3c, 0xc9, 0x00,
+  // 37: restI
+  0xc9, 0x00, 0xd3, 0x3c, 0x3c, 0xc4, 0xc4, 0xd3, 0xd3, 0x2d, 0x2d,
+  // 38: sitI
+  0xe2, 0x00, 0xc4, 0x1e, 0x1e, 0xa6, 0xa6, 0x3c, 0x3c, 0x2d, 0x2d,
+  // 39: sleepI
+  0xf6, 0x9c, 0x00, 0x50, 0x50, 0xb0, 0xb0, 0xc9, 0xc9, 0x37, 0x37,
+  // 40: strI
+  0x00, 0x1e, 0x00, 0xc4, 0xc4, 0xf1, 0xf1, 0x3c, 0x3c, 0xd3, 0xd3,
+  // 41: zeroI
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  // 42: fistbump
+  0xce, 0xb0, 0xbd, 0x32, 0x46, 0xb0, 0xb0, 0x1e, 0xb5, 0x3c, 0x3c, 0x8e,
+  0xc0, 0x00, 0x8b, 0xa0, 0x00, 0x84, 0xb0, 0x00,
+  // 43: restlaidout
+  0xc8, 0xbc, 0x00, 0xa6, 0xa6, 0x5a, 0x5a, 0x5a, 0x5a, 0xa6, 0xa6,
+};
+
+static const SkillInfo kSkillInfo[kSkillCount] PROGMEM = {
+  {     0, 31,  8,   0,   0, {   7,  18 } },  // 0: bdI
+  {   212, 37,  8,   0,   0, {   6,  24 } },  // 1: bkI
+  {   212, 37,  8,   0,   0, {   6,  24 } },  // 2: bkLI
+  {   212, 37,  8,   0,   0, {   6,  24 } },  // 3: bkRI
+  {   387, 26,  8,   0,  -5, {   7,  15 } },  // 4: crI
+  {   387, 26,  8,   0,  -5, {   7,  15 } },  // 5: crLI
+  {   387, 26,  8,   0,  -5, {   7,  15 } },  // 6: crRI
+  {   519, 20,  8,   0, -20, {   6,  13 } },  // 7: lyI
+  {   609, 54,  8,   0,  30, {  19,  46 } },  // 8: stairN
+  {   843, 30,  8,   0,   0, {   1,  13 } },  // 9: trI
+  {  1012, 25,  8,   0,   0, {  20,   2 } },  // 10: trLI
+  {  1136, 25,  8,   0,   0, {   7,  14 } },  // 11: trRI
+  {  1262, 17,  8,   0,   0, {   2,  10 } },  // 12: vtI
+  {  1366, 43,  8,   0,   0, {   7,  29 } },  // 13: wkFI
+  {  1557, 43,  8,   0,   0, {  26,  12 } },  // 14: wkLI
+  {  1752, 43,  8,   0,   0, {   4,  33 } },  // 15: wkRI
+  {  1947,  1, 11,   0,   0, { 255, 255 } },  // 16: balanceI
+  {  1958,  1, 11,   0, -15, { 255, 255 } },  // 17: buttUpI
+  {  1969,  1, 11,   0,   0, { 255, 255 } },  // 18: calibI
+  {  1980,  1, 11, -15, -15, { 255, 255 } },  // 19: cd1I
+  {  1991,  1, 11,  15, -15, { 255, 255 } },  // 20: cd2I
+  {  2002,  1, 11,   0, -75, { 255, 255 } },  // 21: droppedI
+  {  2013,  1, 11,   0,  75, { 255, 255 } },  // 22: liftedI
+  {  2024,  1, 11,   0,   0, { 255, 255 } },  // 23: peeI
+  {  2035,  1, 11,   0,   0, { 255, 255 } },  // 24: pee1I
+  {  2046,  1, 11,   0,   0, { 255, 255 } },  // 25: pu1I
+  {  2057,  1, 11,   0,   0, { 255, 255 } },  // 26: pu2I
+  {  2068,  1, 11,   0,   0, { 255, 255 } },  // 27: rc1I
+  {  2079,  1, 11,   0,   0, { 255, 255 } },  // 28: rc10I
+  {  2090,  1, 11,   0,   0, { 255, 255 } },  // 29: rc2I
+  {  2101,  1, 11,   0,   0, { 255, 255 } },  // 30: rc3I
+  {  2112,  1, 11,   0,   0, { 255, 255 } },  // 31: rc4I
+  {  2123,  1, 11,   0,   0, { 255, 255 } },  // 32: rc5I
+  {  2134,  1, 11,   0,   0, { 255, 255 } },  // 33: rc6I
+  {  2145,  1, 11,   0,   0, { 255, 255 } },  // 34: rc7I
+  {  2156,  1, 11,   0,   0, { 255, 255 } },  // 35: rc8I
+  {  2167,  1, 11,   0,   0, { 255, 255 } },  // 36: rc9I
+  {  2178,  1, 11,   0,   0, { 255, 255 } },  // 37: restI
+  {  2189,  1, 11,   0,  30, { 255, 255 } },  // 38: sitI
+  {  2200,  1, 11,   0,   0, { 255, 255 } },  // 39: sleepI
+  {  2211,  1, 11,   0,  15, { 255, 255 } },  // 40: strI
+  {  2222,  1, 11,   0,   0, { 255, 255 } },  // 41: zeroI
+  {  2233,  2, 11,   0,  30, { 255, 255 } },  // 42: fistbump
+  {  2253,  1, 11,   0,   0, { 255, 255 } },  // 43: restlaidout
+};
+
+// 423 frames in 2264 bytes (3471 bytes unencoded), 326 escaped values.
+// 567 bytes saved by playing variant skills from their base.
@@ -0,0 +1,232 @@
+// Host tool that converts the skills in Instinct.h into skill_frames.h.
+//
+// Instinct.h stores frames in the OpenCat 16 DOF, 11 DOF or 8 DOF walking
+// layouts. The generated table stores every frame in ServoIndex order,
+// delta encoded as described next to kNibbleEscape in skills.h. Walking
+// frames keep only the leg servos; their head, neck and tail are always zero.
+// Skills listed in skill_variants.h share the frames of their base skill.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#define PROGMEM
+#include "Instinct.h"
+#include "servo_animator.h"
+#include "skill_variants.h"
+
+static const int kWalkingFirstServo = kServoLeftFrontShoulder;
+
+// Converts one Instinct.h frame of frame_dofs values into ServoIndex order.
+static void ConvertFrame(const char* frame_start, int frame_dofs,
+                         int8_t* frame) {
+  const char* walking_frame;
+  if (frame_dofs == WalkingDOF) {
+    walking_frame = frame_start;
+    frame[kServoHead] = 0;
+    frame[kServoNeck] = 0;
+    frame[kServoTail] = 0;
+  } else {
+    frame[kServoHead] = frame_start[0];
+    frame[kServoNeck] = frame_start[1];
+    frame[kServoTail] = frame_start[2];
+    walking_frame = frame_start + (frame_dofs == 16 ? 8 : 3);
+  }
+  frame[kServoLeftFrontShoulder] = walking_frame[0];
+  frame[kServoRightFrontShoulder] = walking_frame[1];
+  frame[kServoRightBackShoulder] = walking_frame[2];
+  frame[kServoLeftBackShoulder] = walking_frame[3];
+  frame[kServoLeftFrontKnee] = walking_frame[4];
+  frame[kServoRightFrontKnee] = walking_frame[5];
+  frame[kServoRightBackKnee] = walking_frame[6];
+  frame[kServoLeftBackKnee] = walking_frame[7];
+}
+
+class NibbleWriter {
+ public:
+  explicit NibbleWriter(std::vector<uint8_t>* out) : out_(out) {}
+
+  void Write(uint8_t nibble) {
+    if (high_) {
+      out_->push_back(nibble << 4);
+    } else {
+      out_->back() |= nibble;
+    }
+    high_ = !high_;
+  }
+
+  void WriteValue(int8_t value) {
+    Write(uint8_t(value) >> 4);
+    Write(uint8_t(value) & 0xf);
+  }
+
+ private:
+  std::vector<uint8_t>* out_;
+  bool high_ = true;
+};
+
+// Appends the encoded frames of one skill to data and returns the count of
+// values that needed an escape.
+static int EncodeSkill(const std::vector<std::vector<int8_t>>& frames,
+                       int first_servo, std::vector<uint8_t>* data) {
+  NibbleWriter writer(data);
+  int escapes = 0;
+  for (size_t number = 0; number < frames.size(); ++number) {
+    for (int i = first_servo; i < kServoCount; ++i) {
+      int value = frames[number][i];
+      if (number == 0) {
+        writer.WriteValue(value);
+        continue;
+      }
+      int delta = value - frames[number - 1][i];
+      if (delta >= -7 && delta <= 7) {
+        writer.Write(uint8_t(delta) & 0xf);
+      } else {
+        writer.Write(kNibbleEscape);
+        writer.WriteValue(value);
+        ++escapes;
+      }
+    }
+  }
+  return escapes;
+}
+
+// Largest distance of a leg joint of frame from the same joint of pose.
+static int LegDistance(const std::vector<int8_t>& frame, const int8_t* pose) {
+  int distance = 0;
+  for (int i = kWalkingFirstServo; i < kServoCount; ++i)
+    distance = std::max(distance, abs(frame[i] - pose[i]));
+  return distance;
+}
+
+// Distance of frame number of the frames in context from the standing pose
+// of the balance skill. Frames with the feet down and under the body let a
+// gait stop and blend into a pose without a lurch.
+static int StandDistance(uint8_t number, const void* context) {
+  const std::vector<std::vector<int8_t>>& frames =
+      *static_cast<const std::vector<std::vector<int8_t>>*>(context);
+  int8_t stand[kServoCount];
+  ConvertFrame(progmemPointer[kAnimationBalance] + 3, 16, stand);
+  return LegDistance(frames[number], stand);
+}
+
+// Prints the stable_frames initializer of a SkillInfo.
+static void PrintStableFrames(const uint8_t* stable) {
+  printf("{");
+  for (int i = 0; i < kStableFramesPerSkill; ++i)
+    printf("%s %3d", i > 0 ? "," : "", stable[i]);
+  printf(" }");
+}
+
+// Returns the skill that animation takes its frames from.
+static int FrameSource(int animation) {
+  for (const SkillVariant& variant : kSkillVariants) {
+    if (variant.animation == animation)
+      return variant.base;
+  }
+  return animation;
+}
+
+// Returns the skill's name including its one letter type suffix.
+static const char* SkillName(int skill) {
+  static const int kNamedSkills =
+      sizeof(skillNameWithType) / sizeof(skillNameWithType[0]);
+  if (skill == kAnimationFistBump)
+    return "fistbump";
+  if (skill == kAnimationRestLaidOut)
+    return "restlaidout";
+  if (skill < kNamedSkills)
+    return skillNameWithType[skill];
+  return "?";
+}
+
+int main() {
+  static_assert(sizeof(progmemPointer) / sizeof(progmemPointer[0]) ==
+                NUM_SKILLS, "progmemPointer must list NUM_SKILLS skills");
+  std::vector<uint8_t> data;
+  int offsets[NUM_SKILLS];
+  uint8_t stable_frames[NUM_SKILLS][kStableFramesPerSkill];
+  int total_frames = 0;
+  int total_escapes = 0;
+  int unencoded_bytes = 0;
+  int derived_bytes = 0;
+
+  printf("// Generated by skill_frames_gen from Instinct.h. Do not edit.\n\n");
+  printf("static const int kSkillCount = %d;\n\n", NUM_SKILLS);
+  printf("static const uint8_t kSkillData[] PROGMEM = {");
+  for (int skill = 0; skill < NUM_SKILLS; ++skill) {
+    const char* instinct = progmemPointer[skill];
+    offsets[skill] = data.size();
+    for (int i = 0; i < kStableFramesPerSkill; ++i)
+      stable_frames[skill][i] = kNoStableFrame;
+    if (instinct == nullptr)
+      continue;
+    int frame_count = instinct[0];
+    int frame_dofs = 16;
+    if (frame_count < 0) {
+      frame_count = -frame_count;
+      frame_dofs = ActualDOF;
+    } else if (frame_count > 1) {
+      frame_dofs = WalkingDOF;
+    }
+    int first_servo = frame_dofs == WalkingDOF ? kWalkingFirstServo : 0;
+
+    std::vector<std::vector<int8_t>> frames(
+        frame_count, std::vector<int8_t>(kServoCount));
+    for (int number = 0; number < frame_count; ++number) {
+      ConvertFrame(instinct + 3 + frame_dofs * number, frame_dofs,
+                   frames[number].data());
+    }
+    if (frame_dofs == WalkingDOF)
+      PickStableFrames(frame_count, StandDistance, &frames,
+                       stable_frames[skill]);
+    if (FrameSource(skill) != skill) {
+      std::vector<uint8_t> derived;
+      EncodeSkill(frames, first_servo, &derived);
+      derived_bytes += derived.size();
+      continue;
+    }
+    total_escapes += EncodeSkill(frames, first_servo, &data);
+    total_frames += frame_count;
+    unencoded_bytes += frame_count * (kServoCount - first_servo);
+
+    printf("\n  // %d: %s", skill, SkillName(skill));
+    for (size_t i = offsets[skill]; i < data.size(); ++i) {
+      if ((i - offsets[skill]) % 12 == 0)
+        printf("\n ");
+      printf(" 0x%02x,", data[i]);
+    }
+  }
+  printf("\n};\n\n");
+
+  printf("static const SkillInfo kSkillInfo[kSkillCount] PROGMEM = {\n");
+  for (int skill = 0; skill < NUM_SKILLS; ++skill) {
+    const char* instinct = progmemPointer[skill];
+    if (instinct == nullptr) {
+      printf("  { %5d,  0,  0,   0,   0, ", offsets[skill]);
+      PrintStableFrames(stable_frames[skill]);
+      printf(" },  // %d\n", skill);
+      continue;
+    }
+    // Variants describe the frames of their base, with their own posture.
+    int source = FrameSource(skill);
+    int frame_count = progmemPointer[source][0];
+    int stored_servos = kServoCount;
+    if (frame_count < 0)
+      frame_count = -frame_count;
+    else if (frame_count > 1)
+      stored_servos = kServoCount - kWalkingFirstServo;
+    printf("  { %5d, %2d, %2d, %3d, %3d, ", offsets[source], frame_count,
+           stored_servos, instinct[1], instinct[2]);
+    PrintStableFrames(stable_frames[source]);
+    printf(" },  // %d: %s\n", skill, SkillName(skill));
+  }
+  printf("};\n\n");
+  printf("// %d frames in %d bytes (%d bytes unencoded), %d escaped values.\n",
+         total_frames, int(data.size()), unencoded_bytes, total_escapes);
+  printf("// %d bytes saved by playing variant skills from their base.\n",
+         derived_bytes);
+  return 0;
+}
@@ -0,0 +1,22 @@
+// Skills played as transforms of other skills instead of stored frames. The
+// frames of these skills in Instinct.h are left out of skill_frames.h;
+// skills_test checks that the transforms still reproduce them.
+
+static const SkillVariant kSkillVariants[] PROGMEM = {
+  // bkL and bkR shrink one side of bk to a third.
+  { kAnimationBackUpLeft, kAnimationBackUp,
+    { false, 43, kGaitScaleOne, { 34, -61, -2, 2 } } },
+  { kAnimationBackUpRight, kAnimationBackUp,
+    { false, kGaitScaleOne, 43, { 34, -61, -2, 2 } } },
+  // crL and crR do the same to cr.
+  { kAnimationCrawlLeft, kAnimationCrawl,
+    { false, 45, kGaitScaleOne, { 37, -49, -28, 5 } } },
+  { kAnimationCrawlRight, kAnimationCrawl,
+    { false, kGaitScaleOne, 45, { 37, -49, -28, 5 } } },
+  // trR and wkR stay stored. trR mirrors trL only half a cycle on, so a
+  // mirror would start it on the wrong step, and wkR is up to 9 degrees off
+  // a mirror of wkL.
+};
+
+static const uint8_t kSkillVariantCount =
+    sizeof(kSkillVariants) / sizeof(kSkillVariants[0]);
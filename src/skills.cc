@@ -0,0 +1,147 @@
+#include "skills.h"
+
+#ifndef TESTING
+#include <Arduino.h>
+#else
+#define PROGMEM
+#define memcpy_P memcpy
+#define pgm_read_byte(_a) (*(_a))
+#endif  // TESTING
+
+#include <string.h>
+
+// Generated from Instinct.h by skill_frames_gen, see Makefile.host.
+#include "skill_frames.h"
+#include "skill_variants.h"
+
+static const int kWalkingFirstServo = kServoLeftFrontShoulder;
+
+bool GetSkillInfo(int animation, SkillInfo* info) {
+  if (animation < 0 || animation >= kSkillCount)
+    return false;
+  memcpy_P(info, &kSkillInfo[animation], sizeof(*info));
+  return info->frame_count != 0;
+}
+
+bool GetSkillVariant(int animation, SkillVariant* variant) {
+  for (uint8_t i = 0; i < kSkillVariantCount; ++i) {
+    if (pgm_read_byte(&kSkillVariants[i].animation) == animation) {
+      memcpy_P(variant, &kSkillVariants[i], sizeof(*variant));
+      return true;
+    }
+  }
+  return false;
+}
+
+static void Swap(int8_t* frame, int a, int b) {
+  int8_t value = frame[a];
+  frame[a] = frame[b];
+  frame[b] = value;
+}
+
+void ApplyGaitTransform(const GaitTransform& transform, int8_t* frame) {
+  if (transform.mirror) {
+    Swap(frame, kServoLeftFrontShoulder, kServoRightFrontShoulder);
+    Swap(frame, kServoLeftBackShoulder, kServoRightBackShoulder);
+    Swap(frame, kServoLeftFrontKnee, kServoRightFrontKnee);
+    Swap(frame, kServoLeftBackKnee, kServoRightBackKnee);
+  }
+  for (int leg = 0; leg < 4; ++leg) {
+    int shoulder = kServoLeftFrontShoulder + leg;
+    bool left = shoulder == kServoLeftFrontShoulder ||
+        shoulder == kServoLeftBackShoulder;
+    int scale = left ? transform.left_scale : transform.right_scale;
+    if (scale == kGaitScaleOne)
+      continue;
+    bool front = shoulder <= kServoRightFrontShoulder;
+    int servos[2] = { shoulder, kServoLeftFrontKnee + leg };
+    for (int joint = 0; joint < 2; ++joint) {
+      int pivot = transform.pivot[joint * 2 + (front ? 0 : 1)];
+      int8_t* angle = &frame[servos[joint]];
+      // |*angle - pivot| < 256, so the product fits 16 bits.
+      *angle = pivot + (((*angle - pivot) * scale + 64) >> 7);
+    }
+  }
+}
+
+bool FrameCursor::Open(int animation) {
+  Close();
+  SkillInfo info;
+  if (!GetSkillInfo(animation, &info))
+    return false;
+
+  SkillVariant variant;
+  if (GetSkillVariant(animation, &variant))
+    transform_ = variant.transform;
+
+  data_ = kSkillData + info.offset;
+  animation_ = animation;
+  frame_dofs_ = info.frame_dofs;
+  frame_count_ = info.frame_count;
+  Rewind();
+  return true;
+}
+
+void FrameCursor::Close() {
+  data_ = nullptr;
+  animation_ = -1;
+  frame_dofs_ = 0;
+  frame_count_ = 0;
+  transform_ = kGaitIdentity;
+  Rewind();
+}
+
+void FrameCursor::Rewind() {
+  next_byte_ = data_;
+  next_frame_ = 0;
+  low_nibble_pending_ = false;
+  memset(frame_, 0, sizeof(frame_));
+}
+
+bool FrameCursor::Read(int number, int8_t* frame) {
+  if (number < 0 || number >= frame_count_)
+    return false;
+  if (number < next_frame_)
+    Rewind();
+  while (next_frame_ < number)
+    Next(frame);
+  return Next(frame);
+}
+
+uint8_t FrameCursor::ReadNibble() {
+  if (low_nibble_pending_) {
+    low_nibble_pending_ = false;
+    return byte_ & 0xf;
+  }
+  byte_ = pgm_read_byte(next_byte_++);
+  low_nibble_pending_ = true;
+  return byte_ >> 4;
+}
+
+int8_t FrameCursor::ReadValue() {
+  uint8_t high = ReadNibble();
+  return (high << 4) | ReadNibble();
+}
+
+bool FrameCursor::Next(int8_t* frame) {
+  if (next_frame_ >= frame_count_)
+    return false;
+
+  int first_servo = frame_dofs_ == kServoCount ? 0 : kWalkingFirstServo;
+  for (int i = first_servo; i < kServoCount; ++i) {
+    if (next_frame_ == 0) {
+      frame_[i] = ReadValue();
+      continue;
+    }
+    uint8_t nibble = ReadNibble();
+    if (nibble == kNibbleEscape)
+      frame_[i] = ReadValue();
+    else
+      frame_[i] += int8_t(nibble << 4) >> 4;
+  }
+  memcpy(frame, frame_, sizeof(frame_));
+  ApplyGaitTransform(transform_, frame);
+
+  ++next_frame_;
+  return true;
+}
@@ -0,0 +1,184 @@
+#ifndef _SKILLS_H
+#define _SKILLS_H
+
+#include <stdint.h>
+
+// Skills by their number in Instinct.h.
+const int kAnimationRest = 37;
+const int kAnimationCalibrationPose = 18;
+const int kAnimationSleep = 39;
+const int kAnimationStretch = 40;
+const int kAnimationBalance = 16;
+const int kAnimationSit = 38;
+const int kAnimationWalk = 13;
+const int kAnimationWalkLeft = 14;
+const int kAnimationWalkRight = 15;
+const int kAnimationBackUp = 1;
+const int kAnimationBackUpLeft = 2;
+const int kAnimationBackUpRight = 3;
+const int kAnimationCrawl = 4;
+const int kAnimationCrawlLeft = 5;
+const int kAnimationCrawlRight = 6;
+const int kAnimationTr = 9;
+const int kAnimationTrLeft = 10;
+const int kAnimationTrRight = 11;
+const int kAnimationWalkInPlace = 12;
+const int kAnimationFistBump = 42;
+const int kAnimationRestLaidOut = 43;
+
+enum ServoIndex {
+  kServoHead,
+  kServoNeck,
+  kServoTail,
+  kServoLeftFrontShoulder,
+  kServoRightFrontShoulder,
+  kServoRightBackShoulder,
+  kServoLeftBackShoulder,
+  kServoLeftFrontKnee,
+  kServoRightFrontKnee,
+  kServoRightBackKnee,
+  kServoLeftBackKnee,
+  kServoCount
+};
+
+// Frames a gait may stop at, see SkillInfo.
+static const int kStableFramesPerSkill = 2;
+static const uint8_t kNoStableFrame = 0xff;
+
+// Picks the kStableFramesPerSkill frames of a cycle of count frames whose
+// legs are closest to standing, by distance(number, context), into stable.
+// Each is at least a quarter cycle from the ones before it, so that a stop
+// does not wait for most of a stride. Shared by skill_frames_gen and
+// GaitGenerator.
+inline void PickStableFrames(uint8_t count,
+                             int (*distance)(uint8_t number,
+                                             const void* context),
+                             const void* context, uint8_t* stable) {
+  for (int i = 0; i < kStableFramesPerSkill; ++i)
+    stable[i] = kNoStableFrame;
+  if (count <= 1)
+    return;
+  for (int found = 0; found < kStableFramesPerSkill; ++found) {
+    int best_distance = 0;
+    for (uint8_t number = 0; number < count; ++number) {
+      bool too_close = false;
+      for (int i = 0; i < found; ++i) {
+        int apart = number - stable[i];
+        if (apart < 0)
+          apart = -apart;
+        if (apart > count - apart)
+          apart = count - apart;
+        too_close |= apart < count / 4;
+      }
+      if (too_close)
+        continue;
+      int number_distance = distance(number, context);
+      if (stable[found] == kNoStableFrame || number_distance < best_distance) {
+        stable[found] = number;
+        best_distance = number_distance;
+      }
+    }
+  }
+}
+
+// Layout and posture of one skill, known without touching its frames.
+struct SkillInfo {
+  uint16_t offset;  // Index of the skill's first byte in kSkillData.
+  uint8_t frame_count;
+  // Servos stored per frame: kServoCount, or only the legs for walking
+  // frames whose head, neck and tail are zero.
+  uint8_t frame_dofs;
+  int8_t roll;  // Expected body roll and pitch while playing the skill.
+  int8_t pitch;
+  // Frames of a gait with the feet under the body, at least a quarter cycle
+  // apart, or kNoStableFrame. Picked by skill_frames_gen.
+  uint8_t stable_frames[kStableFramesPerSkill];
+};
+
+// Looks up the compile time metadata for animation. Returns false if the
+// animation does not exist or is compiled out.
+bool GetSkillInfo(int animation, SkillInfo* info);
+
+// Changes a stored gait as it is decoded, so that turning and mirrored gaits
+// need no frames of their own. Mirroring swaps the left and right legs. Each
+// side's leg motion is then scaled about pivot, which holds the front
+// shoulder, back shoulder, front knee and back knee angles.
+struct GaitTransform {
+  bool mirror;
+  uint8_t left_scale;  // Q7, kGaitScaleOne leaves a side unchanged.
+  uint8_t right_scale;
+  int8_t pivot[4];
+};
+
+static const uint8_t kGaitScaleOne = 1 << 7;
+static const GaitTransform kGaitIdentity = {
+  false, kGaitScaleOne, kGaitScaleOne, { 0, 0, 0, 0 }
+};
+
+// A skill played as a transform of another skill's frames.
+struct SkillVariant {
+  uint8_t animation;
+  uint8_t base;
+  GaitTransform transform;
+};
+
+// Returns true and fills in variant if animation is derived from another
+// skill, see skill_variants.h.
+bool GetSkillVariant(int animation, SkillVariant* variant);
+
+// Applies transform to a frame in ServoIndex order.
+void ApplyGaitTransform(const GaitTransform& transform, int8_t* frame);
+
+// Skill frames are stored as a stream of 4 bit nibbles. The first frame
+// holds each servo as two nibbles. Every later frame holds each servo as a
+// signed nibble delta from the previous frame, or kNibbleEscape followed by
+// the servo's value as two nibbles. skill_frames_gen produces the stream.
+static const uint8_t kNibbleEscape = 0x8;
+
+// Steps through the frames of one skill. Open looks up the skill's SkillInfo
+// once, after which frames are decoded into caller owned buffers of
+// kServoCount entries in ServoIndex order. Several cursors may be open at once.
+class FrameCursor {
+ public:
+  FrameCursor() {}
+
+  // Returns false, leaving the cursor closed, if animation is not available.
+  // Variants are opened with their transform applied.
+  bool Open(int animation);
+  // Applies transform to the frames decoded from now on.
+  void set_transform(const GaitTransform& transform) {
+    transform_ = transform;
+  }
+  const GaitTransform& transform() const { return transform_; }
+  void Close();
+  bool is_open() const { return data_ != nullptr; }
+  int animation() const { return animation_; }
+  int frame_count() const { return frame_count_; }
+  // Number of the frame that Next will decode.
+  int frame_number() const { return next_frame_; }
+
+  // Decodes the given frame and leaves the cursor just after it. Frames
+  // before the cursor are decoded again from the first frame.
+  bool Read(int number, int8_t* frame);
+  // Decodes the next frame, returning false after the last one.
+  bool Next(int8_t* frame);
+  void Rewind();
+
+ private:
+  uint8_t ReadNibble();
+  int8_t ReadValue();
+
+  const uint8_t* data_ = nullptr;
+  const uint8_t* next_byte_ = nullptr;
+  int animation_ = -1;
+  uint8_t frame_dofs_ = 0;
+  uint8_t frame_count_ = 0;
+  uint8_t next_frame_ = 0;
+  uint8_t byte_ = 0;
+  bool low_nibble_pending_ = false;
+  GaitTransform transform_ = kGaitIdentity;
+  // Last decoded frame, which the next frame's deltas apply to.
+  int8_t frame_[kServoCount];
+};
+
+#endif  // _SKILLS_H
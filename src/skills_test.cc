@@ -0,0 +1,362 @@
+#include "skills.h"
+
+#include <string.h>
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "servo_animator.h"
+
+// Instinct.h names clash with POSIX functions such as sleep().
+namespace instinct {
+#define PROGMEM
+#include "Instinct.h"
+}  // namespace instinct
+
+using instinct::progmemPointer;
+
+// Decodes a frame straight from Instinct.h the way GetFrame used to before
+// skill_frames.h, or returns false past the last frame.
+static bool GetInstinctFrame(int animation, int number, int8_t* result) {
+  const char* instinct = progmemPointer[animation];
+  const char* walking_frame = nullptr;
+  int total_frames = instinct[0];
+  int frame_dofs = 16;
+  if (total_frames < 0) {
+    total_frames = -total_frames;
+    frame_dofs = ActualDOF;
+  } else if (total_frames > 1) {
+    frame_dofs = WalkingDOF;
+  }
+  if (number >= total_frames)
+    return false;
+
+  const char* frame_start = instinct + 3 + frame_dofs * number;
+  if (frame_dofs == 16 || frame_dofs == ActualDOF) {
+    result[kServoHead] = frame_start[0];
+    result[kServoNeck] = frame_start[1];
+    result[kServoTail] = frame_start[2];
+    if (frame_dofs == 16)
+      walking_frame = frame_start + 8;
+    else
+      walking_frame = frame_start + 3;
+  } else {
+    walking_frame = frame_start;
+    result[kServoHead] = 0;
+    result[kServoNeck] = 0;
+    result[kServoTail] = 0;
+  }
+  result[kServoLeftFrontKnee] = walking_frame[4];
+  result[kServoLeftFrontShoulder] = walking_frame[0];
+  result[kServoRightFrontKnee] = walking_frame[5];
+  result[kServoRightFrontShoulder] = walking_frame[1];
+  result[kServoLeftBackShoulder] = walking_frame[3];
+  result[kServoLeftBackKnee] = walking_frame[7];
+  result[kServoRightBackShoulder] = walking_frame[2];
+  result[kServoRightBackKnee] = walking_frame[6];
+  return true;
+}
+
+TEST(FrameCursorTest, OpenMissingAnimations) {
+  FrameCursor cursor;
+  EXPECT_FALSE(cursor.Open(-1));
+  EXPECT_FALSE(cursor.Open(1000));
+  EXPECT_FALSE(cursor.is_open());
+  int8_t frame[kServoCount];
+  EXPECT_FALSE(cursor.Next(frame));
+}
+
+TEST(FrameCursorTest, WalkingFramesAreInServoOrder) {
+  FrameCursor cursor;
+  ASSERT_TRUE(cursor.Open(kAnimationWalk));
+  EXPECT_EQ(43, cursor.frame_count());
+
+  int8_t frame[kServoCount];
+  ASSERT_TRUE(cursor.Next(frame));
+  const int8_t expected[kServoCount] = {
+    0, 0, 0, 20, 57, -65, -52, 3, 10, 10, -6
+  };
+  for (int i = 0; i < kServoCount; ++i)
+    EXPECT_EQ(expected[i], frame[i]) << "servo " << i;
+  EXPECT_EQ(1, cursor.frame_number());
+}
+
+TEST(FrameCursorTest, NextStopsAtEndAndRewinds) {
+  FrameCursor cursor;
+  ASSERT_TRUE(cursor.Open(kAnimationWalk));
+  int8_t frame[kServoCount];
+  int8_t first[kServoCount];
+  ASSERT_TRUE(cursor.Next(first));
+  int frames = 1;
+  while (cursor.Next(frame))
+    ++frames;
+  EXPECT_EQ(43, frames);
+  EXPECT_FALSE(cursor.Next(frame));
+
+  cursor.Rewind();
+  ASSERT_TRUE(cursor.Next(frame));
+  EXPECT_EQ(0, memcmp(first, frame, sizeof(frame)));
+}
+
+TEST(FrameCursorTest, ReadMatchesNext) {
+  FrameCursor sequential;
+  FrameCursor random;
+  ASSERT_TRUE(sequential.Open(kAnimationTr));
+  ASSERT_TRUE(random.Open(kAnimationTr));
+  int8_t frame[kServoCount];
+  int8_t other[kServoCount];
+  for (int i = sequential.frame_count() - 1; i >= 0; --i) {
+    ASSERT_TRUE(random.Read(i, other));
+    EXPECT_EQ(i + 1, random.frame_number());
+  }
+  for (int i = 0; i < sequential.frame_count(); ++i) {
+    ASSERT_TRUE(sequential.Next(frame));
+    ASSERT_TRUE(random.Read(i, other));
+    EXPECT_EQ(0, memcmp(frame, other, sizeof(frame))) << "frame " << i;
+  }
+  EXPECT_FALSE(random.Read(sequential.frame_count(), other));
+}
+
+TEST(FrameCursorTest, SingleAndActualFrameSkills) {
+  FrameCursor cursor;
+  ASSERT_TRUE(cursor.Open(kAnimationRest));
+  EXPECT_EQ(1, cursor.frame_count());
+  ASSERT_TRUE(cursor.Open(kAnimationFistBump));
+  EXPECT_EQ(2, cursor.frame_count());
+  int8_t frame[kServoCount];
+  ASSERT_TRUE(cursor.Read(1, frame));
+  EXPECT_EQ(-20, frame[kServoHead]);
+  EXPECT_EQ(75, frame[kServoRightFrontKnee]);
+}
+
+TEST(SkillInfoTest, DescribesEverySkill) {
+  SkillInfo info;
+  ASSERT_TRUE(GetSkillInfo(kAnimationWalk, &info));
+  EXPECT_EQ(43, info.frame_count);
+  EXPECT_EQ(8, info.frame_dofs);
+
+  ASSERT_TRUE(GetSkillInfo(kAnimationCrawl, &info));
+  EXPECT_EQ(26, info.frame_count);
+  EXPECT_EQ(0, info.roll);
+  EXPECT_EQ(-5, info.pitch);
+
+  ASSERT_TRUE(GetSkillInfo(kAnimationSit, &info));
+  EXPECT_EQ(1, info.frame_count);
+  EXPECT_EQ(11, info.frame_dofs);
+  EXPECT_EQ(30, info.pitch);
+
+  ASSERT_TRUE(GetSkillInfo(kAnimationFistBump, &info));
+  EXPECT_EQ(2, info.frame_count);
+  EXPECT_EQ(11, info.frame_dofs);
+
+  EXPECT_FALSE(GetSkillInfo(-1, &info));
+  EXPECT_FALSE(GetSkillInfo(1000, &info));
+}
+
+TEST(SkillInfoTest, GaitsHaveStableFrames) {
+  const int kGaits[] = {
+    kAnimationWalk, kAnimationWalkLeft, kAnimationTr, kAnimationCrawl,
+    kAnimationBackUp, kAnimationWalkInPlace
+  };
+  int8_t stand[kServoCount];
+  FrameCursor cursor;
+  ASSERT_TRUE(cursor.Open(kAnimationBalance));
+  ASSERT_TRUE(cursor.Next(stand));
+  for (int gait : kGaits) {
+    SkillInfo info;
+    ASSERT_TRUE(GetSkillInfo(gait, &info));
+    int count = info.frame_count;
+    int first = info.stable_frames[0];
+    int second = info.stable_frames[1];
+    ASSERT_LT(first, count) << "gait " << gait;
+    ASSERT_LT(second, count) << "gait " << gait;
+    int apart = abs(first - second);
+    EXPECT_GE(std::min(apart, count - apart), count / 4) << "gait " << gait;
+
+    // No frame has its legs closer to the standing pose than the first.
+    int distances[64];
+    ASSERT_TRUE(cursor.Open(gait));
+    int8_t frame[kServoCount];
+    for (int number = 0; cursor.Next(frame); ++number) {
+      distances[number] = 0;
+      for (int i = kServoLeftFrontShoulder; i < kServoCount; ++i) {
+        distances[number] = std::max(distances[number],
+                                     abs(frame[i] - stand[i]));
+      }
+    }
+    for (int number = 0; number < count; ++number)
+      EXPECT_LE(distances[first], distances[number]) << "gait " << gait;
+  }
+
+  SkillInfo info;
+  ASSERT_TRUE(GetSkillInfo(kAnimationFistBump, &info));
+  EXPECT_EQ(kNoStableFrame, info.stable_frames[0]);
+  ASSERT_TRUE(GetSkillInfo(kAnimationSit, &info));
+  EXPECT_EQ(kNoStableFrame, info.stable_frames[0]);
+}
+
+TEST(SkillInfoTest, FrameCountMatchesDecodedFrames) {
+  for (int animation = 0; animation < 1000; ++animation) {
+    SkillInfo info;
+    FrameCursor cursor;
+    if (!GetSkillInfo(animation, &info)) {
+      EXPECT_FALSE(cursor.Open(animation));
+      continue;
+    }
+    ASSERT_TRUE(cursor.Open(animation));
+    int8_t frame[kServoCount];
+    int frames = 0;
+    while (cursor.Next(frame))
+      ++frames;
+    EXPECT_EQ(info.frame_count, frames) << "animation " << animation;
+  }
+}
+
+TEST(SkillFramesTest, EveryFrameMatchesInstinct) {
+  int frames = 0;
+  for (int animation = 0; animation < NUM_SKILLS; ++animation) {
+    SkillInfo info;
+    FrameCursor cursor;
+    if (progmemPointer[animation] == nullptr) {
+      EXPECT_FALSE(GetSkillInfo(animation, &info));
+      continue;
+    }
+    ASSERT_TRUE(GetSkillInfo(animation, &info));
+    EXPECT_EQ(progmemPointer[animation][1], info.roll);
+    EXPECT_EQ(progmemPointer[animation][2], info.pitch);
+    SkillVariant variant;
+    if (GetSkillVariant(animation, &variant))
+      continue;  // See SkillVariantTest.
+    ASSERT_TRUE(cursor.Open(animation));
+
+    int8_t expected[kServoCount];
+    int8_t actual[kServoCount];
+    int number = 0;
+    while (GetInstinctFrame(animation, number, expected)) {
+      ASSERT_TRUE(cursor.Next(actual));
+      for (int i = 0; i < kServoCount; ++i) {
+        ASSERT_EQ(expected[i], actual[i])
+            << "animation " << animation << " frame " << number
+            << " servo " << i;
+      }
+      ++number;
+      ++frames;
+    }
+    EXPECT_FALSE(cursor.Next(actual));
+    EXPECT_EQ(number, info.frame_count);
+  }
+  printf("Skill frames checked=%d\n", frames);
+}
+
+TEST(SkillFramesTest, EverySkillIsCompiledIn) {
+  for (int animation = 0; animation < NUM_SKILLS; ++animation) {
+    SkillInfo info;
+    EXPECT_TRUE(GetSkillInfo(animation, &info)) << "animation " << animation;
+  }
+}
+
+TEST(FrameCursorTest, ReadBackwardsRedecodes) {
+  FrameCursor cursor;
+  FrameCursor reference;
+  ASSERT_TRUE(cursor.Open(kAnimationWalk));
+  ASSERT_TRUE(reference.Open(kAnimationWalk));
+  int8_t frames[43][kServoCount];
+  for (int i = 0; i < 43; ++i)
+    ASSERT_TRUE(reference.Next(frames[i]));
+
+  int8_t frame[kServoCount];
+  const int kOrder[] = { 42, 3, 2, 40, 0, 41, 1 };
+  for (int number : kOrder) {
+    ASSERT_TRUE(cursor.Read(number, frame));
+    EXPECT_EQ(0, memcmp(frames[number], frame, sizeof(frame)))
+        << "frame " << number;
+  }
+}
+
+TEST(SkillVariantTest, ApplyGaitTransform) {
+  int8_t frame[kServoCount] = { 1, 2, 3, 10, 20, -30, -40, 50, 60, 70, 80 };
+  GaitTransform transform = kGaitIdentity;
+  ApplyGaitTransform(transform, frame);
+  EXPECT_EQ(10, frame[kServoLeftFrontShoulder]);
+
+  transform.mirror = true;
+  ApplyGaitTransform(transform, frame);
+  const int8_t mirrored[kServoCount] = {
+    1, 2, 3, 20, 10, -40, -30, 60, 50, 80, 70
+  };
+  EXPECT_EQ(0, memcmp(mirrored, frame, sizeof(frame)));
+
+  // Halve the right side about the pivot.
+  transform = { false, kGaitScaleOne, kGaitScaleOne / 2, { 10, -10, 20, 30 } };
+  ApplyGaitTransform(transform, frame);
+  const int8_t scaled[kServoCount] = {
+    1, 2, 3, 20, 10, -25, -30, 60, 35, 55, 70
+  };
+  EXPECT_EQ(0, memcmp(scaled, frame, sizeof(frame)));
+}
+
+// Bytes that frames of the leg servos take in skill_frames.h, see
+// kNibbleEscape.
+static int EncodedLegBytes(const int8_t (*frames)[kServoCount], int count) {
+  int nibbles = 0;
+  for (int number = 0; number < count; ++number) {
+    for (int i = kServoLeftFrontShoulder; i < kServoCount; ++i) {
+      if (number == 0) {
+        nibbles += 2;
+        continue;
+      }
+      int delta = frames[number][i] - frames[number - 1][i];
+      nibbles += delta >= -7 && delta <= 7 ? 1 : 3;
+    }
+  }
+  return (nibbles + 1) / 2;
+}
+
+// Variants must reproduce the Instinct.h frames they replace, frame for frame,
+// so that a variant started from a pose takes the same first step.
+TEST(SkillVariantTest, VariantsMatchInstinctWithinTolerance) {
+  const int kMaxError = 3;
+  const int kMaxMeanErrorTenths = 4;
+  int saved_bytes = 0;
+  for (int animation = 0; animation < NUM_SKILLS; ++animation) {
+    SkillVariant variant;
+    if (!GetSkillVariant(animation, &variant))
+      continue;
+    EXPECT_NE(nullptr, progmemPointer[variant.base]);
+    EXPECT_FALSE(GetSkillVariant(variant.base, &variant));
+
+    FrameCursor cursor;
+    ASSERT_TRUE(cursor.Open(animation));
+    int count = cursor.frame_count();
+    int8_t actual[64][kServoCount];
+    int8_t expected[64][kServoCount];
+    ASSERT_LE(count, 64);
+    for (int i = 0; i < count; ++i) {
+      ASSERT_TRUE(cursor.Next(actual[i]));
+      ASSERT_TRUE(GetInstinctFrame(animation, i, expected[i]));
+    }
+    EXPECT_FALSE(GetInstinctFrame(animation, count, expected[0]));
+
+    int max_error = 0;
+    int total = 0;
+    for (int i = 0; i < count; ++i) {
+      for (int servo = 0; servo < kServoCount; ++servo) {
+        int error = abs(actual[i][servo] - expected[i][servo]);
+        total += error;
+        if (error > max_error)
+          max_error = error;
+      }
+    }
+    int values = count * kServoCount;
+    EXPECT_LE(max_error, kMaxError) << "animation " << animation;
+    EXPECT_LE(total * 10, kMaxMeanErrorTenths * values)
+        << "animation " << animation;
+    printf("Variant %d of %d: max error %d, mean error %.2f\n", animation,
+           variant.base, max_error, double(total) / values);
+    // Each variant leaves its encoded frames out of flash and adds its
+    // entry in kSkillVariants.
+    saved_bytes += EncodedLegBytes(expected, count) - int(sizeof(variant));
+  }
+  EXPECT_GT(saved_bytes, 0);
+  printf("Variants save %d bytes of flash, less the code that applies "
+         "them\n", saved_bytes);
+}
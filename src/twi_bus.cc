@@ -0,0 +1,226 @@
+#include "twi_bus.h"
+
+#ifndef TESTING
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif  // TESTING
+
+// TWSR status codes for a master.
+static const uint8_t kStarted = 0x08;
+static const uint8_t kRestarted = 0x10;
+static const uint8_t kWriteAddressAck = 0x18;
+static const uint8_t kWriteAddressNack = 0x20;
+static const uint8_t kWriteDataAck = 0x28;
+static const uint8_t kWriteDataNack = 0x30;
+static const uint8_t kReadAddressAck = 0x40;
+static const uint8_t kReadAddressNack = 0x48;
+static const uint8_t kReadDataAck = 0x50;
+static const uint8_t kReadDataNack = 0x58;
+
+static const uint8_t kRun = kTwiInterrupt | kTwiEnable | kTwiInterruptEnable;
+
+#ifndef TESTING
+static TwiBus* s_bus = nullptr;
+
+ISR(TWI_vect) {
+  s_bus->OnInterrupt();
+}
+#endif  // TESTING
+
+void TwiBus::Begin() {
+#ifndef TESTING
+  s_bus = this;
+  // Internal pull-ups, in case the board has none.
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  TWSR = 0;
+  TWBR = uint8_t((F_CPU / kClockHz - 16) / 2);
+  TWCR = kTwiEnable | kTwiInterruptEnable;
+#endif  // TESTING
+}
+
+bool TwiBus::Queue(TwiTransaction* transaction) {
+  if (transaction->status == kTwiQueued)
+    return false;
+#ifndef TESTING
+  uint8_t old_sreg = SREG;
+  cli();
+#endif  // TESTING
+  bool queued = count_ < kQueueSize;
+  if (queued) {
+    transaction->status = kTwiQueued;
+    queue_[(first_ + count_) % kQueueSize] = transaction;
+    if (count_++ == 0) {
+      WaitForStop();
+      started_ms_ = Millis();
+      Control(kRun | kTwiStart);
+    }
+  }
+#ifndef TESTING
+  SREG = old_sreg;
+#endif  // TESTING
+  return queued;
+}
+
+uint8_t TwiBus::Run(TwiTransaction* transaction) {
+  while (!Queue(transaction))
+    Wait();
+  while (!transaction->finished())
+    Wait();
+  return transaction->status;
+}
+
+void TwiBus::CheckTimeout() {
+#ifndef TESTING
+  uint8_t old_sreg = SREG;
+  cli();
+#endif  // TESTING
+  if (count_ > 0 && uint16_t(Millis() - started_ms_) >= kTimeoutMs) {
+    // Disabling the TWI drops its state and lets go of the pins. The stop
+    // that Finish then sets brings it back as an unaddressed slave with the
+    // lines released, or is followed by the next transaction's start.
+    Control(0);
+    Finish(kTwiTimeout);
+  }
+#ifndef TESTING
+  SREG = old_sreg;
+#endif  // TESTING
+}
+
+void TwiBus::Finish(uint8_t status) {
+  TwiTransaction* transaction = queue_[first_];
+  transaction->status = status;
+  // The transaction keeps its slot through the callback, so that one queued
+  // from it starts after the stop below.
+  if (transaction->on_done)
+    transaction->on_done(transaction);
+  first_ = (first_ + 1) % kQueueSize;
+  --count_;
+  // A stop followed at once by the next transaction's start.
+  if (count_ > 0) {
+    started_ms_ = Millis();
+    Control(kRun | kTwiStop | kTwiStart);
+  } else {
+    Control(kRun | kTwiStop);
+  }
+}
+
+// Each interrupt has the hardware waiting on one action: send an address or
+// a byte, ask for a byte, or end with a stop.
+void TwiBus::OnInterrupt() {
+  if (count_ == 0) {
+    Control(kRun | kTwiStop);
+    return;
+  }
+  TwiTransaction* transaction = queue_[first_];
+  uint8_t status = Status();
+  switch (status) {
+    case kStarted:
+    case kRestarted: {
+      // Writes go first, so that a register address can precede a read
+      // after a repeated start.
+      bool read = status == kRestarted ||
+          (transaction->write_length == 0 && transaction->read_length > 0);
+      index_ = 0;
+      WriteData(uint8_t(transaction->address << 1) | (read ? 1 : 0));
+      Control(kRun);
+      break;
+    }
+
+    case kWriteAddressAck:
+    case kWriteDataAck:
+      if (index_ < transaction->write_length) {
+        WriteData(transaction->write_data[index_++]);
+        Control(kRun);
+      } else if (transaction->read_length > 0) {
+        Control(kRun | kTwiStart);
+      } else {
+        Finish(kTwiDone);
+      }
+      break;
+
+    case kReadAddressAck:
+      // Acknowledges every byte but the last.
+      Control(transaction->read_length > 1 ? kRun | kTwiAck : kRun);
+      break;
+
+    case kReadDataAck:
+    case kReadDataNack:
+      transaction->read_data[index_++] = ReadData();
+      if (index_ < transaction->read_length)
+        Control(index_ + 1 < transaction->read_length ? kRun | kTwiAck : kRun);
+      else
+        Finish(kTwiDone);
+      break;
+
+    case kWriteAddressNack:
+    case kWriteDataNack:
+    case kReadAddressNack:
+      Finish(kTwiNack);
+      break;
+
+    default:
+      // Lost arbitration or an illegal start or stop.
+      Finish(kTwiBusError);
+      break;
+  }
+}
+
+// Finish marks a transaction done as soon as it asks for the stop, so the
+// next one can be queued while the stop is still going out. Setting the
+// start over it would drop the stop, so this waits for the hardware to
+// clear it first, as Wire does.
+void TwiBus::WaitForStop() {
+#ifndef TESTING
+  while (TWCR & kTwiStop) {
+  }
+#endif  // TESTING
+}
+
+void TwiBus::Wait() {
+#ifdef TESTING
+  fake_wait_();
+#endif  // TESTING
+  CheckTimeout();
+}
+
+uint16_t TwiBus::Millis() const {
+#ifndef TESTING
+  return millis();
+#else
+  return fake_millis_;
+#endif  // TESTING
+}
+
+uint8_t TwiBus::Status() const {
+#ifndef TESTING
+  return TWSR & 0xf8;
+#else
+  return fake_status_;
+#endif  // TESTING
+}
+
+uint8_t TwiBus::ReadData() const {
+#ifndef TESTING
+  return TWDR;
+#else
+  return fake_data_;
+#endif  // TESTING
+}
+
+void TwiBus::WriteData(uint8_t data) {
+#ifndef TESTING
+  TWDR = data;
+#else
+  fake_data_ = data;
+#endif  // TESTING
+}
+
+void TwiBus::Control(uint8_t bits) {
+#ifndef TESTING
+  TWCR = bits;
+#else
+  fake_control_ = bits;
+#endif  // TESTING
+}
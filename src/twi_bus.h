@@ -0,0 +1,104 @@
+#ifndef _TWI_BUS_H
+#define _TWI_BUS_H
+
+#include <stdint.h>
+
+#ifdef TESTING
+#include <functional>
+#endif  // TESTING
+
+enum TwiStatus {
+  kTwiIdle,
+  kTwiQueued,
+  kTwiDone,
+  // The device did not acknowledge its address or a written byte.
+  kTwiNack,
+  kTwiBusError,
+  // The transaction ran past TwiBus::kTimeoutMs and the TWI was reset.
+  kTwiTimeout,
+};
+
+// A write, a read, or a write followed by a repeated start and a read, to
+// one device. The caller owns the transaction and its buffers until status
+// is kTwiDone or an error, so nothing is copied or allocated.
+struct TwiTransaction {
+  uint8_t address;  // 7 bit device address.
+  const uint8_t* write_data;
+  uint8_t write_length;
+  uint8_t* read_data;
+  uint8_t read_length;
+  // Called from the interrupt once status is final, or nullptr.
+  void (*on_done)(TwiTransaction* transaction);
+  volatile uint8_t status;
+
+  bool finished() const { return status >= kTwiDone; }
+};
+
+// Runs queued TwiTransactions on the ATmega328p TWI at 400kHz, entirely from
+// the TWI interrupt, in place of the blocking Wire library. Devices share the
+// bus by queueing their own transactions, which run in order.
+class TwiBus {
+ public:
+  static const uint8_t kQueueSize = 4;
+  static const uint32_t kClockHz = 400000;
+  // Longest a transaction may take. The largest, 48 bytes, takes about 1.5ms.
+  static const uint8_t kTimeoutMs = 10;
+
+  TwiBus() {}
+
+  // Takes over the TWI and its pins.
+  void Begin();
+  // Marks transaction queued and starts it once the ones before it are done.
+  // Returns false if the queue is full or transaction is already queued.
+  bool Queue(TwiTransaction* transaction);
+  // Queues transaction and waits for it, for setup code.
+  uint8_t Run(TwiTransaction* transaction);
+  bool idle() const { return count_ == 0; }
+  // Fails the running transaction with kTwiTimeout and resets the TWI once
+  // the transaction has run for kTimeoutMs, as when a device holds the bus
+  // or an interrupt is lost, and starts the next one. Run calls it while it
+  // waits; callers polling their own transactions call it as they poll.
+  void CheckTimeout();
+
+  // The TWI interrupt.
+  void OnInterrupt();
+
+ private:
+  void Finish(uint8_t status);
+  void WaitForStop();
+  void Wait();
+  uint16_t Millis() const;
+  uint8_t Status() const;
+  uint8_t ReadData() const;
+  void WriteData(uint8_t data);
+  void Control(uint8_t bits);
+
+  TwiTransaction* volatile queue_[kQueueSize] = {};
+  volatile uint8_t first_ = 0;
+  volatile uint8_t count_ = 0;
+  // Bytes of the running transaction's write or read done so far.
+  uint8_t index_ = 0;
+  // When the running transaction started, in Millis.
+  volatile uint16_t started_ms_ = 0;
+
+#ifdef TESTING
+ public:
+  // Stand ins for the TWSR status bits, TWDR and the last TWCR write.
+  uint8_t fake_status_ = 0;
+  uint8_t fake_data_ = 0;
+  uint8_t fake_control_ = 0;
+  uint16_t fake_millis_ = 0;
+  // Plays the hardware while Run waits.
+  std::function<void()> fake_wait_;
+#endif  // TESTING
+};
+
+// TWCR bits.
+static const uint8_t kTwiInterrupt = 1 << 7;
+static const uint8_t kTwiAck = 1 << 6;
+static const uint8_t kTwiStart = 1 << 5;
+static const uint8_t kTwiStop = 1 << 4;
+static const uint8_t kTwiEnable = 1 << 2;
+static const uint8_t kTwiInterruptEnable = 1 << 0;
+
+#endif  // _TWI_BUS_H
@@ -0,0 +1,161 @@
+#include "twi_bus.h"
+#include "twi_bus_testfake.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+
+static const uint8_t kAddress = 0x68;
+
+static TwiTransaction Transaction(const uint8_t* write_data,
+                                  uint8_t write_length, uint8_t* read_data,
+                                  uint8_t read_length) {
+  TwiTransaction transaction = {
+    kAddress, write_data, write_length, read_data, read_length, nullptr,
+    kTwiIdle
+  };
+  return transaction;
+}
+
+class TwiBusTest : public testing::Test {
+ protected:
+  TwiBusTest() : device_(kAddress) {}
+
+  TwiBus bus_;
+  TwiDeviceFake device_;
+};
+
+TEST_F(TwiBusTest, WritesRegisters) {
+  const uint8_t kWrite[] = { 0x6b, 0, 0x08 };
+  device_.registers_[0x6b] = 0x40;
+  TwiTransaction write = Transaction(kWrite, sizeof(kWrite), nullptr, 0);
+  ASSERT_TRUE(bus_.Queue(&write));
+  EXPECT_EQ(kTwiQueued, write.status);
+  EXPECT_FALSE(bus_.idle());
+  // Start, address and three bytes.
+  EXPECT_EQ(5, device_.Run(&bus_));
+  EXPECT_EQ(kTwiDone, write.status);
+  EXPECT_TRUE(bus_.idle());
+  EXPECT_EQ(0, device_.registers_[0x6b]);
+  EXPECT_EQ(0x08, device_.registers_[0x6c]);
+}
+
+TEST_F(TwiBusTest, ReadsAfterARepeatedStart) {
+  for (int i = 0; i < 14; ++i)
+    device_.registers_[0x3b + i] = 100 + i;
+  const uint8_t kRegister = 0x3b;
+  uint8_t data[14] = {};
+  TwiTransaction read = Transaction(&kRegister, 1, data, sizeof(data));
+  ASSERT_TRUE(bus_.Queue(&read));
+  EXPECT_FALSE(read.finished());
+  // Start, address, register, repeated start, address and 14 bytes.
+  EXPECT_EQ(19, device_.Run(&bus_));
+  EXPECT_EQ(kTwiDone, read.status);
+  EXPECT_EQ(1, device_.transactions_);
+  for (int i = 0; i < 14; ++i)
+    EXPECT_EQ(100 + i, data[i]) << i;
+
+  // A lone byte is read without an acknowledge.
+  device_.registers_[0x3b + 14] = 7;
+  uint8_t byte = 0;
+  TwiTransaction read_one = Transaction(nullptr, 0, &byte, 1);
+  ASSERT_TRUE(bus_.Queue(&read_one));
+  EXPECT_EQ(3, device_.Run(&bus_));
+  EXPECT_EQ(kTwiDone, read_one.status);
+  EXPECT_EQ(7, byte);
+}
+
+TEST_F(TwiBusTest, MissingDeviceFailsAndFreesTheBus) {
+  device_.absent_ = true;
+  const uint8_t kRegister = 0x3b;
+  uint8_t data[2] = { 1, 2 };
+  TwiTransaction read = Transaction(&kRegister, 1, data, sizeof(data));
+  ASSERT_TRUE(bus_.Queue(&read));
+  device_.Run(&bus_);
+  EXPECT_EQ(kTwiNack, read.status);
+  EXPECT_TRUE(read.finished());
+  EXPECT_TRUE(bus_.idle());
+  EXPECT_EQ(1, data[0]);
+
+  device_.absent_ = false;
+  ASSERT_TRUE(bus_.Queue(&read));
+  device_.Run(&bus_);
+  EXPECT_EQ(kTwiDone, read.status);
+}
+
+static std::vector<TwiTransaction*> s_done;
+
+static void RecordDone(TwiTransaction* transaction) {
+  s_done.push_back(transaction);
+}
+
+TEST_F(TwiBusTest, QueuedTransactionsRunInOrder) {
+  s_done.clear();
+  const uint8_t kWrites[][2] = { { 1, 11 }, { 2, 22 }, { 3, 33 }, { 4, 44 } };
+  TwiTransaction writes[TwiBus::kQueueSize];
+  for (int i = 0; i < TwiBus::kQueueSize; ++i) {
+    writes[i] = Transaction(kWrites[i], 2, nullptr, 0);
+    writes[i].on_done = RecordDone;
+    ASSERT_TRUE(bus_.Queue(&writes[i]));
+  }
+  TwiTransaction extra = Transaction(kWrites[0], 2, nullptr, 0);
+  EXPECT_FALSE(bus_.Queue(&extra));
+  EXPECT_FALSE(bus_.Queue(&writes[0]));
+  EXPECT_EQ(kTwiIdle, extra.status);
+
+  // All of them run from the interrupts of the first.
+  device_.Run(&bus_);
+  EXPECT_TRUE(bus_.idle());
+  EXPECT_EQ(int(TwiBus::kQueueSize), device_.transactions_);
+  ASSERT_EQ(int(TwiBus::kQueueSize), int(s_done.size()));
+  for (int i = 0; i < TwiBus::kQueueSize; ++i) {
+    EXPECT_EQ(&writes[i], s_done[i]);
+    EXPECT_EQ(kTwiDone, writes[i].status);
+    EXPECT_EQ(kWrites[i][1], device_.registers_[kWrites[i][0]]);
+  }
+}
+
+TEST_F(TwiBusTest, CallbackCanQueueTheNextTransaction) {
+  static TwiBus* s_bus;
+  static TwiTransaction s_second;
+  static const uint8_t kFirst[] = { 5, 55 };
+  static const uint8_t kSecond[] = { 6, 66 };
+  s_bus = &bus_;
+  s_second = Transaction(kSecond, 2, nullptr, 0);
+  TwiTransaction first = Transaction(kFirst, 2, nullptr, 0);
+  first.on_done = [](TwiTransaction*) { s_bus->Queue(&s_second); };
+  ASSERT_TRUE(bus_.Queue(&first));
+  device_.Run(&bus_);
+  EXPECT_EQ(kTwiDone, s_second.status);
+  EXPECT_EQ(55, device_.registers_[5]);
+  EXPECT_EQ(66, device_.registers_[6]);
+}
+
+TEST_F(TwiBusTest, StalledTransactionTimesOut) {
+  const uint8_t kFirst[] = { 5, 55 };
+  const uint8_t kSecond[] = { 6, 66 };
+  TwiTransaction first = Transaction(kFirst, 2, nullptr, 0);
+  TwiTransaction second = Transaction(kSecond, 2, nullptr, 0);
+  bus_.fake_millis_ = 65530;
+  ASSERT_TRUE(bus_.Queue(&first));
+  ASSERT_TRUE(bus_.Queue(&second));
+
+  // No interrupt comes, as when a device holds the clock low.
+  bus_.fake_millis_ += TwiBus::kTimeoutMs - 1;
+  bus_.CheckTimeout();
+  EXPECT_EQ(kTwiQueued, first.status);
+  bus_.fake_millis_ += 1;
+  bus_.CheckTimeout();
+  EXPECT_EQ(kTwiTimeout, first.status);
+  EXPECT_TRUE(first.finished());
+  // The TWI comes back with a stop and starts the next transaction, which
+  // gets its own time.
+  EXPECT_EQ(kTwiInterrupt | kTwiStop | kTwiStart | kTwiEnable |
+            kTwiInterruptEnable, bus_.fake_control_);
+  bus_.CheckTimeout();
+  EXPECT_EQ(kTwiQueued, second.status);
+  device_.Run(&bus_);
+  EXPECT_EQ(kTwiDone, second.status);
+  EXPECT_EQ(66, device_.registers_[6]);
+  EXPECT_EQ(0, device_.registers_[5]);
+  EXPECT_TRUE(bus_.idle());
+}
@@ -0,0 +1,59 @@
+#include "twi_bus_testfake.h"
+
+bool TwiDeviceFake::Acknowledge(uint8_t address_byte) {
+  return !absent_ && (address_byte >> 1) == address_;
+}
+
+uint8_t TwiDeviceFake::ReadRegister() {
+  if (fifo_register_ >= 0) {
+    registers_[fifo_register_ - 2] = fifo_.size() >> 8;
+    registers_[fifo_register_ - 1] = fifo_.size() & 0xff;
+    if (pointer_ == fifo_register_) {
+      uint8_t data = 0;
+      if (!fifo_.empty()) {
+        data = fifo_.front();
+        fifo_.pop_front();
+      }
+      return data;
+    }
+  }
+  return registers_[pointer_++ & 0x7f];
+}
+
+int TwiDeviceFake::Run(TwiBus* bus) {
+  int interrupts = 0;
+  uint8_t last = 0;
+  while (bus->fake_control_ & kTwiInterrupt) {
+    uint8_t control = bus->fake_control_;
+    if (control & kTwiStart) {
+      bool repeated = last != 0 && !(control & kTwiStop);
+      if (!repeated)
+        ++transactions_;
+      bus->fake_status_ = repeated ? 0x10 : 0x08;
+    } else if (control & kTwiStop) {
+      break;
+    } else if (last == 0x08 || last == 0x10) {
+      uint8_t address_byte = bus->fake_data_;
+      writing_ = !(address_byte & 1);
+      first_byte_ = writing_;
+      bool ack = Acknowledge(address_byte);
+      bus->fake_status_ = writing_ ? (ack ? 0x18 : 0x20) : (ack ? 0x40 : 0x48);
+    } else if (writing_) {
+      if (first_byte_)
+        pointer_ = bus->fake_data_ & 0x7f;
+      else
+        registers_[pointer_++ & 0x7f] = bus->fake_data_;
+      first_byte_ = false;
+      bus->fake_status_ = 0x28;
+    } else {
+      bus->fake_data_ = ReadRegister();
+      bus->fake_status_ = (control & kTwiAck) ? 0x50 : 0x58;
+    }
+    last = bus->fake_status_;
+    bus->fake_control_ = 0;
+    bus->OnInterrupt();
+    ++interrupts;
+  }
+  bus->fake_control_ = 0;
+  return interrupts;
+}
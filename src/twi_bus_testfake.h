@@ -0,0 +1,39 @@
+#ifndef _TWI_BUS_TESTFAKE_H
+#define _TWI_BUS_TESTFAKE_H
+
+#include <deque>
+
+#include "twi_bus.h"
+
+// A device with 128 byte registers on a TwiBus. Writes set the register
+// pointer with their first byte and fill registers from it with the rest;
+// reads return registers from the pointer on. Run() plays the hardware
+// through the bus interrupts until the bus stops.
+class TwiDeviceFake {
+ public:
+  explicit TwiDeviceFake(uint8_t address) : address_(address) {}
+
+  // Returns the interrupts it took.
+  int Run(TwiBus* bus);
+
+  uint8_t registers_[128] = {};
+  // Stops acknowledging its address, as when unplugged.
+  bool absent_ = false;
+  int transactions_ = 0;
+  // Reads of this register take bytes from fifo_ and leave the register
+  // pointer, like a FIFO data port, and the two registers before it hold the
+  // FIFO's byte count, high byte first.
+  int fifo_register_ = -1;
+  std::deque<uint8_t> fifo_;
+
+ private:
+  bool Acknowledge(uint8_t address_byte);
+  uint8_t ReadRegister();
+
+  uint8_t address_;
+  uint8_t pointer_ = 0;
+  bool writing_ = false;
+  bool first_byte_ = false;
+};
+
+#endif  // _TWI_BUS_TESTFAKE_H